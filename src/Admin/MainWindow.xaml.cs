@@ -589,6 +589,11 @@ public partial class MainWindow : Window
                     if (_isDemoMode) _demoManager!.StopFocusStream(msg.Target);
                     else _tcpManager!.StopFocusStream(msg.Target);
                     break;
+                case "tile_visibility":
+                    // Grid tile scrolled in/out of view or filtered — feeds the bandwidth allocator
+                    if (!_isDemoMode && !string.IsNullOrEmpty(msg.Target))
+                        _tcpManager!.SetTileVisibility(msg.Target, msg.Payload == "1");
+                    break;
                 case "lock":
                     if (_isDemoMode) _demoManager!.LockStudent(msg.Target);
                     else _tcpManager!.LockStudent(msg.Target);
@@ -1131,6 +1136,14 @@ public partial class MainWindow : Window
         {
             sb.AppendLine($"  Connected: {_tcpManager!.ConnectedCount} / {_tcpManager.TotalEndpoints}");
             sb.AppendLine($"  Known IPs: {string.Join(", ", _tcpManager.GetAllEndpointIps())}");
+
+            var bw = _tcpManager.Bandwidth;
+            sb.AppendLine();
+            sb.AppendLine("── Bandwidth ──");
+            sb.AppendLine($"  Allocated: {bw.LastTotalKbps:N0} / {bw.Budget.TotalKbps:N0} kbps");
+            sb.AppendLine($"  Decode:    {bw.LastTotalFps:F1} / {bw.Budget.TotalDecodeFps:F0} fps");
+            sb.AppendLine($"  Tiles:     {bw.LastVisibleCount} visible, {bw.LastHiddenCount} hidden, {bw.LastFocusedCount} focused");
+            sb.AppendLine($"  Fairness:  {bw.LastFairness:F3} (Jain)");
         }
 
         if (_discoveryListener != null)
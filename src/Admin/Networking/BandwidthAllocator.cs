@@ -0,0 +1,306 @@
+// ───────────────────────────────────────────────────────────────────────────
+// BandwidthAllocator.cs — Classroom-wide sub-stream budget (teacher side)
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// Every student used to stream its sub-stream at a fixed 1 fps / 200 kbps,
+// whether the tile was on screen or not and whether anything on the
+// student's desktop was moving. With 50+ students that wastes the link and
+// the dashboard's WebCodecs decode budget on idle or scrolled-away tiles.
+//
+// The allocator splits two shared budgets across students:
+//   - TotalKbps       — aggregate network budget for all streams
+//   - TotalDecodeFps  — aggregate decode rate the dashboard can sustain
+//
+// Focused students (main-stream open) get a fixed reservation first. Hidden
+// tiles get a trickle floor. The remainder is water-filled across visible
+// tiles, weighted by activity (the student's reported dirty ratio), with a
+// per-student floor and cap. The result is pushed to each student as an
+// RvSetTarget command; the student clamps it to its own limits.
+//
+// Jain's fairness index over demand-normalised allocations is exposed for
+// the Diagnostics window (1.0 = every visible tile served in proportion to
+// its activity).
+// ───────────────────────────────────────────────────────────────────────────
+
+namespace TADAdmin;
+
+/// <summary>Budget and per-student bounds for <see cref="BandwidthAllocator"/>.</summary>
+public sealed class BandwidthBudget
+{
+    /// <summary>Aggregate bitrate for all student streams, main-streams included.</summary>
+    public int TotalKbps { get; set; } = 40_000;
+
+    /// <summary>Aggregate frames/s the dashboard can decode across all tiles.</summary>
+    public double TotalDecodeFps { get; set; } = 60;
+
+    /// <summary>Reserved per focused student for its 30 fps main-stream.</summary>
+    public int FocusKbps { get; set; } = 3000;
+    public double FocusDecodeFps { get; set; } = 30;
+
+    /// <summary>Visible tile bounds.</summary>
+    public int MinKbps { get; set; } = 60;
+    public int MaxKbps { get; set; } = 600;
+    public double MinFps { get; set; } = 0.25;
+    public double MaxFps { get; set; } = 5;
+
+    /// <summary>Trickle rate for hidden tiles and the sub-stream of a focused student.</summary>
+    public int HiddenKbps { get; set; } = 30;
+    public double HiddenFps { get; set; } = 0.1;
+}
+
+/// <summary>Sub-stream target for one student.</summary>
+public readonly struct StreamTarget : IEquatable<StreamTarget>
+{
+    public int FrameIntervalMs { get; }
+    public int BitrateKbps { get; }
+
+    public StreamTarget(int frameIntervalMs, int bitrateKbps)
+    {
+        FrameIntervalMs = frameIntervalMs;
+        BitrateKbps = bitrateKbps;
+    }
+
+    public bool IsDefault => FrameIntervalMs == 0 && BitrateKbps == 0;
+
+    /// <summary>
+    /// True when either value moved by more than <paramref name="tolerance"/>
+    /// (relative). Used to avoid re-sending targets on tiny fluctuations.
+    /// </summary>
+    public bool DiffersFrom(StreamTarget other, double tolerance)
+    {
+        if (IsDefault || other.IsDefault) return !Equals(other);
+        return Math.Abs(FrameIntervalMs - other.FrameIntervalMs) > other.FrameIntervalMs * tolerance
+            || Math.Abs(BitrateKbps - other.BitrateKbps) > other.BitrateKbps * tolerance;
+    }
+
+    public bool Equals(StreamTarget other) =>
+        FrameIntervalMs == other.FrameIntervalMs && BitrateKbps == other.BitrateKbps;
+    public override bool Equals(object? obj) => obj is StreamTarget t && Equals(t);
+    public override int GetHashCode() => HashCode.Combine(FrameIntervalMs, BitrateKbps);
+}
+
+public sealed class BandwidthAllocator
+{
+    private readonly object _lock = new();
+    private readonly Dictionary<string, Demand> _demands = new();
+
+    public BandwidthBudget Budget { get; }
+
+    // ─── Last allocation (for Diagnostics) ────────────────────────────
+
+    /// <summary>Sum of all assigned bitrates in the last allocation, main-stream reservations included.</summary>
+    public int LastTotalKbps { get; private set; }
+
+    /// <summary>Sum of all assigned sub-stream frame rates in the last allocation.</summary>
+    public double LastTotalFps { get; private set; }
+
+    /// <summary>Jain's fairness index over visible tiles (0..1, 1 = perfectly proportional).</summary>
+    public double LastFairness { get; private set; } = 1.0;
+
+    public int LastVisibleCount { get; private set; }
+    public int LastHiddenCount { get; private set; }
+    public int LastFocusedCount { get; private set; }
+
+    public BandwidthAllocator(BandwidthBudget? budget = null)
+    {
+        Budget = budget ?? new BandwidthBudget();
+    }
+
+    // ─── Demand Inputs ────────────────────────────────────────────────
+
+    public void Track(string ip)
+    {
+        lock (_lock) _demands.TryAdd(ip, new Demand());
+    }
+
+    public void Forget(string ip)
+    {
+        lock (_lock) _demands.Remove(ip);
+    }
+
+    /// <summary>Tile scrolled into / out of view, or hidden by a filter.</summary>
+    public void SetVisible(string ip, bool visible)
+    {
+        lock (_lock) GetOrAdd(ip).Visible = visible;
+    }
+
+    /// <summary>Main-stream (focused remote view) opened or closed for this student.</summary>
+    public void SetFocused(string ip, bool focused)
+    {
+        lock (_lock) GetOrAdd(ip).Focused = focused;
+    }
+
+    /// <summary>Latest dirty ratio reported by the student (0.0–1.0).</summary>
+    public void SetActivity(string ip, double dirtyRatio)
+    {
+        lock (_lock) GetOrAdd(ip).Activity = Math.Clamp(dirtyRatio, 0, 1);
+    }
+
+    // ─── Allocation ───────────────────────────────────────────────────
+
+    /// <summary>
+    /// Compute sub-stream targets for the given (connected) students.
+    /// Students not in <paramref name="ips"/> are ignored and consume no budget.
+    /// </summary>
+    public Dictionary<string, StreamTarget> Allocate(IEnumerable<string> ips)
+    {
+        var budget = Budget;
+        var result = new Dictionary<string, StreamTarget>();
+        var visibleIps = new List<string>();
+        var weights = new List<double>();
+        int hidden = 0, focused = 0;
+
+        lock (_lock)
+        {
+            foreach (var ip in ips)
+            {
+                var d = GetOrAdd(ip);
+                if (d.Focused)
+                {
+                    focused++;
+                    result[ip] = ToTarget(budget.HiddenFps, budget.HiddenKbps);
+                }
+                else if (!d.Visible)
+                {
+                    hidden++;
+                    result[ip] = ToTarget(budget.HiddenFps, budget.HiddenKbps);
+                }
+                else
+                {
+                    visibleIps.Add(ip);
+                    weights.Add(WeightOf(d.Activity));
+                }
+            }
+        }
+
+        // Reservations come off the top; visible tiles share the rest
+        int trickles = hidden + focused;
+        double kbpsLeft = Math.Max(0,
+            budget.TotalKbps - focused * budget.FocusKbps - trickles * budget.HiddenKbps);
+        double fpsLeft = Math.Max(0,
+            budget.TotalDecodeFps - focused * budget.FocusDecodeFps - trickles * budget.HiddenFps);
+
+        var w = weights.ToArray();
+        var kbps = WaterFill(w, kbpsLeft, budget.MinKbps, budget.MaxKbps);
+        var fps = WaterFill(w, fpsLeft, budget.MinFps, budget.MaxFps);
+
+        double totalKbps = focused * budget.FocusKbps + trickles * budget.HiddenKbps;
+        double totalFps = trickles * budget.HiddenFps;
+        for (int i = 0; i < visibleIps.Count; i++)
+        {
+            result[visibleIps[i]] = ToTarget(fps[i], kbps[i]);
+            totalKbps += kbps[i];
+            totalFps += fps[i];
+        }
+
+        LastTotalKbps = (int)Math.Round(totalKbps);
+        LastTotalFps = totalFps;
+        LastFairness = JainIndex(kbps, w);
+        LastVisibleCount = visibleIps.Count;
+        LastHiddenCount = hidden;
+        LastFocusedCount = focused;
+        return result;
+    }
+
+    /// <summary>
+    /// Weighted max-min water-filling. Every participant first gets
+    /// <paramref name="floor"/>; the remainder is split in proportion to
+    /// weight, capping at <paramref name="cap"/> and redistributing the excess.
+    /// If the budget cannot cover the floors, it is split by weight alone.
+    /// </summary>
+    internal static double[] WaterFill(double[] weights, double budget, double floor, double cap)
+    {
+        int n = weights.Length;
+        var alloc = new double[n];
+        if (n == 0) return alloc;
+
+        double weightSum = 0;
+        foreach (var w in weights) weightSum += w;
+
+        if (budget <= floor * n)
+        {
+            for (int i = 0; i < n; i++)
+                alloc[i] = budget * weights[i] / weightSum;
+            return alloc;
+        }
+
+        Array.Fill(alloc, floor);
+        double remaining = budget - floor * n;
+        var active = new bool[n];
+        Array.Fill(active, true);
+        double activeWeight = weightSum;
+
+        // Each pass either saturates at least one participant or finishes
+        while (remaining > 1e-9 && activeWeight > 0)
+        {
+            double level = remaining / activeWeight;
+            bool capped = false;
+
+            for (int i = 0; i < n; i++)
+            {
+                if (!active[i]) continue;
+                double room = cap - alloc[i];
+                if (level * weights[i] >= room)
+                {
+                    alloc[i] = cap;
+                    remaining -= room;
+                    active[i] = false;
+                    activeWeight -= weights[i];
+                    capped = true;
+                }
+            }
+
+            if (capped) continue;
+
+            for (int i = 0; i < n; i++)
+                if (active[i]) alloc[i] += level * weights[i];
+            remaining = 0;
+        }
+
+        return alloc;
+    }
+
+    /// <summary>Jain's index over allocations normalised by weight: (Σx)² / (n·Σx²).</summary>
+    internal static double JainIndex(double[] alloc, double[] weights)
+    {
+        int n = alloc.Length;
+        if (n == 0) return 1.0;
+
+        double sum = 0, sumSq = 0;
+        for (int i = 0; i < n; i++)
+        {
+            double x = alloc[i] / weights[i];
+            sum += x;
+            sumSq += x * x;
+        }
+        return sumSq > 0 ? sum * sum / (n * sumSq) : 1.0;
+    }
+
+    /// <summary>
+    /// Activity weight. The square root lifts small changes (typing, a cursor
+    /// blink in an editor) well above an idle desktop; the base keeps idle
+    /// visible tiles from being starved.
+    /// </summary>
+    private static double WeightOf(double activity) => 0.25 + Math.Sqrt(activity);
+
+    private static StreamTarget ToTarget(double fps, double kbps) =>
+        new((int)Math.Round(1000.0 / Math.Max(fps, 0.01)), (int)Math.Round(kbps));
+
+    private Demand GetOrAdd(string ip)
+    {
+        if (!_demands.TryGetValue(ip, out var d))
+        {
+            d = new Demand();
+            _demands[ip] = d;
+        }
+        return d;
+    }
+
+    private sealed class Demand
+    {
+        public bool Visible = true;
+        public bool Focused;
+        public double Activity;
+    }
+}
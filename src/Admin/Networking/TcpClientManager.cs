@@ -11,6 +11,7 @@
 //   - Dual-stream: sub (1fps 480p grid) + main (30fps 720p focus)
 //   - Per-student command targeting
 //   - Broadcast commands (Lock / Unlock / Collect)
+//   - Classroom-wide sub-stream budget (BandwidthAllocator → RvSetTarget)
 // ───────────────────────────────────────────────────────────────────────────
 
 using System.Collections.Concurrent;
@@ -28,11 +29,23 @@ public sealed class TcpClientManager : IDisposable
     private const int ReconnectBaseMs = 2000;
     private const int ReconnectMaxMs = 30000;
     private const int ReceiveBufferSize = 256 * 1024; // 256 KB
+    private const int RebalanceIntervalMs = 2000;
+    private const double RetargetTolerance = 0.15;    // Re-send only on >15% change
 
     // Endpoint registry: IP → connection state
     private readonly ConcurrentDictionary<string, StudentConnection> _connections = new();
     private readonly CancellationTokenSource _cts = new();
 
+    // Sub-stream budget
+    private readonly BandwidthAllocator _allocator = new();
+    private readonly Timer _rebalanceTimer;
+    private int _rebalancing;
+
+    public TcpClientManager()
+    {
+        _rebalanceTimer = new Timer(_ => Rebalance(), null, RebalanceIntervalMs, RebalanceIntervalMs);
+    }
+
     // ─── Events ───────────────────────────────────────────────────────
 
     /// <summary>Fired when a student reports status (hostname, active window, etc.).</summary>
@@ -55,6 +68,9 @@ public sealed class TcpClientManager : IDisposable
     /// <summary>All known student IPs regardless of connection state.</summary>
     public List<string> GetAllEndpointIps() => _connections.Keys.ToList();
 
+    /// <summary>Sub-stream budget allocator (exposes totals and fairness for Diagnostics).</summary>
+    public BandwidthAllocator Bandwidth => _allocator;
+
     // ─── Endpoint Management ──────────────────────────────────────────
 
     /// <summary>Add a student IP and begin auto-connect loop.</summary>
@@ -65,6 +81,7 @@ public sealed class TcpClientManager : IDisposable
         var conn = new StudentConnection(ip, port);
         if (_connections.TryAdd(ip, conn))
         {
+            _allocator.Track(ip);
             _ = ConnectLoopAsync(conn, _cts.Token);
         }
     }
@@ -74,6 +91,7 @@ public sealed class TcpClientManager : IDisposable
     {
         if (_connections.TryRemove(ip, out var conn))
         {
+            _allocator.Forget(ip);
             conn.Dispose();
         }
     }
@@ -94,9 +112,27 @@ public sealed class TcpClientManager : IDisposable
     public void StopRemoteView(string ip) => SendCommand(ip, TadCommand.RvStop);
 
     /// <summary>Start focused 30fps 720p main-stream for one student.</summary>
-    public void StartFocusStream(string ip) => SendCommand(ip, TadCommand.RvFocusStart);
+    public void StartFocusStream(string ip)
+    {
+        _allocator.SetFocused(ip, true);
+        SendCommand(ip, TadCommand.RvFocusStart);
+        Rebalance();
+    }
+
     /// <summary>Stop focused main-stream (sub-stream keeps running).</summary>
-    public void StopFocusStream(string ip) => SendCommand(ip, TadCommand.RvFocusStop);
+    public void StopFocusStream(string ip)
+    {
+        _allocator.SetFocused(ip, false);
+        SendCommand(ip, TadCommand.RvFocusStop);
+        Rebalance();
+    }
+
+    /// <summary>
+    /// Report whether a student's grid tile is currently on screen.
+    /// Takes effect on the next rebalance tick so scrolling does not
+    /// flood students with retargets.
+    /// </summary>
+    public void SetTileVisibility(string ip, bool visible) => _allocator.SetVisible(ip, visible);
 
     public void BroadcastLock() => BroadcastCommand(TadCommand.Lock);
     public void BroadcastUnlock() => BroadcastCommand(TadCommand.Unlock);
@@ -151,6 +187,7 @@ public sealed class TcpClientManager : IDisposable
                 };
 
                 await conn.Client.ConnectAsync(conn.Ip, conn.Port, ct);
+                conn.LastTarget = default; // Fresh session — student is back on its default profile
                 conn.IsConnected = true;
                 backoff = ReconnectBaseMs; // Reset on success
 
@@ -226,7 +263,10 @@ public sealed class TcpClientManager : IDisposable
                 {
                     var status = JsonSerializer.Deserialize<StudentStatus>(payload.Span);
                     if (status != null)
+                    {
+                        _allocator.SetActivity(ip, status.DirtyRatio);
                         StudentStatusUpdated?.Invoke(ip, status);
+                    }
                 }
                 catch { /* Ignore malformed JSON */ }
                 break;
@@ -258,6 +298,42 @@ public sealed class TcpClientManager : IDisposable
         }
     }
 
+    // ─── Bandwidth Rebalance ──────────────────────────────────────────
+
+    /// <summary>
+    /// Recompute sub-stream targets for all connected students and push the
+    /// ones that changed meaningfully. Runs on a timer and immediately after
+    /// focus changes.
+    /// </summary>
+    private void Rebalance()
+    {
+        if (Interlocked.Exchange(ref _rebalancing, 1) == 1) return;
+        try
+        {
+            var connected = _connections.Values.Where(c => c.IsConnected).ToList();
+            var targets = _allocator.Allocate(connected.Select(c => c.Ip));
+
+            foreach (var conn in connected)
+            {
+                if (!targets.TryGetValue(conn.Ip, out var target)) continue;
+                if (!target.DiffersFrom(conn.LastTarget, RetargetTolerance)) continue;
+
+                var frame = TadFrameCodec.EncodeJson(TadCommand.RvSetTarget, new StreamTargetRequest
+                {
+                    FrameIntervalMs = target.FrameIntervalMs,
+                    BitrateKbps = target.BitrateKbps
+                });
+                if (SendRaw(conn.Ip, frame))
+                    conn.LastTarget = target;
+            }
+        }
+        catch { /* Next tick retries */ }
+        finally
+        {
+            Volatile.Write(ref _rebalancing, 0);
+        }
+    }
+
     // ─── Send Helpers ─────────────────────────────────────────────────
 
     private void SendCommand(string ip, TadCommand cmd, ReadOnlySpan<byte> payload = default)
@@ -322,6 +398,7 @@ public sealed class TcpClientManager : IDisposable
 
     public void Dispose()
     {
+        _rebalanceTimer.Dispose();
         _cts.Cancel();
         foreach (var conn in _connections.Values)
             conn.Dispose();
@@ -340,6 +417,9 @@ public sealed class TcpClientManager : IDisposable
         public TcpClient? Client { get; set; }
         public bool IsConnected { get; set; }
 
+        /// <summary>Last sub-stream target pushed on this session (default = none yet).</summary>
+        public StreamTarget LastTarget { get; set; }
+
         public StudentConnection(string ip, int port)
         {
             Ip = ip;
@@ -262,8 +262,26 @@ function renderTile(student) {
     student.tileEl = tile;
     student.canvas = tile.querySelector('canvas');
     student.ctx = student.canvas.getContext('2d');
+    tileVisibilityObserver.observe(tile);
 }
 
+// ── Tile Visibility (feeds the host's bandwidth allocator) ───────────
+// Tiles that are scrolled away or hidden by a filter (display:none never
+// intersects) drop to a trickle rate; visible tiles share the budget.
+
+const tileVisibility = new Map();     // ip → last reported visibility
+
+const tileVisibilityObserver = new IntersectionObserver((entries) => {
+    for (const entry of entries) {
+        const ip = entry.target.dataset.ip;
+        if (!ip) continue;
+        const visible = entry.isIntersecting;
+        if (tileVisibility.get(ip) === visible) continue;
+        tileVisibility.set(ip, visible);
+        sendToHost({ action: 'tile_visibility', target: ip, payload: visible ? '1' : '0' });
+    }
+}, { threshold: 0 });
+
 function closeAllContextMenus() {
     document.querySelectorAll('.tile-ctx-menu').forEach(m => m.style.display = 'none');
 }
@@ -348,7 +366,11 @@ function ensureStudentTile(ip) {
 function removeStudentTile(ip) {
     const student = students.get(ip);
     if (student) {
-        if (student.tileEl) student.tileEl.remove();
+        if (student.tileEl) {
+            tileVisibilityObserver.unobserve(student.tileEl);
+            student.tileEl.remove();
+        }
+        tileVisibility.delete(ip);
         if (student.decoder) try { student.decoder.close(); } catch {}
         students.delete(ip);
         updateStats();
@@ -0,0 +1,124 @@
+// ───────────────────────────────────────────────────────────────────────────
+// GopCache.cs — Most recent IDR + current GOP for instant stream start
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// A viewer that joins mid-stream cannot decode anything until the next
+// IDR. At 1 fps with a 5 s keyframe interval that is a visible wait. The
+// cache keeps the last keyframe and every delta frame since, so a new
+// viewer can be primed with a decodable sequence immediately while a fresh
+// keyframe is requested from the encoder.
+//
+// Publish and Replay share one lock: a replay never interleaves with live
+// frames, so the viewer sees [cached IDR, cached deltas..., live deltas...]
+// in strict decode order.
+//
+// Cached frames are pooled TadFrameBuffers; the cache holds one reference
+// per frame and releases it when the GOP rolls over or is cleared.
+// ───────────────────────────────────────────────────────────────────────────
+
+using TADBridge.Shared;
+
+namespace TADBridge.Capture;
+
+public sealed class GopCache
+{
+    private readonly object _lock = new();
+    private readonly List<TadFrameBuffer> _frames = new();
+    private readonly int _maxFrames;
+    private readonly int _maxBytes;
+    private int _bytes;
+    private bool _truncated;
+    private long _lastFrameMs;
+
+    /// <param name="maxFrames">Upper bound on cached frames (≥ one GOP at the profile's fps).</param>
+    /// <param name="maxBytes">Upper bound on cached bytes.</param>
+    public GopCache(int maxFrames, int maxBytes)
+    {
+        _maxFrames = maxFrames;
+        _maxBytes = maxBytes;
+    }
+
+    /// <summary>Number of frames currently cached (0 until the first keyframe).</summary>
+    public int Count
+    {
+        get { lock (_lock) return _frames.Count; }
+    }
+
+    /// <summary>Time since the newest cached frame was published.</summary>
+    public TimeSpan Age
+    {
+        get
+        {
+            lock (_lock)
+            {
+                return _frames.Count == 0
+                    ? TimeSpan.MaxValue
+                    : TimeSpan.FromMilliseconds(Environment.TickCount64 - _lastFrameMs);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Cache an encoded frame, then hand it to <paramref name="sink"/> (the
+    /// live viewer) while still holding the lock.
+    /// </summary>
+    public void Publish(TadFrameBuffer frame, bool keyFrame, Action<TadFrameBuffer, bool>? sink)
+    {
+        lock (_lock)
+        {
+            if (keyFrame)
+                ClearLocked();
+
+            // Deltas before the first keyframe, or after the cache overflowed,
+            // are not decodable from the cached prefix — stop appending until
+            // the next IDR. The prefix that is cached stays valid.
+            if (_frames.Count > 0 || keyFrame)
+            {
+                if (!_truncated && _frames.Count < _maxFrames && _bytes + frame.PayloadLength <= _maxBytes)
+                {
+                    _frames.Add(frame.AddRef());
+                    _bytes += frame.PayloadLength;
+                }
+                else
+                {
+                    _truncated = true;
+                }
+            }
+
+            _lastFrameMs = Environment.TickCount64;
+            sink?.Invoke(frame, keyFrame);
+        }
+    }
+
+    /// <summary>
+    /// Send the cached IDR and deltas to <paramref name="sink"/> in decode
+    /// order. Returns the number of frames replayed (0 = nothing usable).
+    /// A truncated GOP is not replayed: live deltas would not follow on from
+    /// the cached prefix, and the viewer would decode garbage until the next IDR.
+    /// </summary>
+    public int Replay(Action<TadFrameBuffer, bool> sink)
+    {
+        lock (_lock)
+        {
+            if (_truncated) return 0;
+            for (int i = 0; i < _frames.Count; i++)
+                sink(_frames[i], i == 0);
+            return _frames.Count;
+        }
+    }
+
+    public void Clear()
+    {
+        lock (_lock) ClearLocked();
+    }
+
+    private void ClearLocked()
+    {
+        foreach (var f in _frames)
+            f.Release();
+        _frames.Clear();
+        _bytes = 0;
+        _truncated = false;
+    }
+}
@@ -3,7 +3,7 @@
 //
 // (C) 2026 TAD Europe — https://tad-it.eu
 //
-// Privacy Shield: Scans the active UI tree for password input fields
+// Privacy Shield: Tracks password input fields in the interactive session
 // using the Windows UIAutomation COM API. Returns their screen coordinates
 // so the ScreenCaptureEngine can draw solid black rectangles over the
 // D3D11 texture BEFORE it reaches the H.264 encoder.
@@ -14,13 +14,21 @@
 // Enhanced features:
 //   • Detects Win32 Edit + ES_PASSWORD, WPF PasswordBox, browser <input type=password>
 //   • Configurable redaction categories (addresses, credit cards, etc.)
-//   • Thread-safe rectangle cache with atomic swap
+//   • Event-driven: SetWinEventHook focus / structure / location events
+//     mark single top-level windows dirty; only those are re-queried
+//     (IUIAutomation::ElementFromHandle + FindAll), not the whole desktop
+//   • Versioned, immutable rectangle snapshots (RedactionEngine.cs)
 //   • GPU-side ClearTextureRegion via ScreenCaptureEngine.ApplyPrivacyRedaction
+//   • CPU-side fill / pixelate / blur for system-memory frames (RedactionKernel.cs)
 //
-// Refresh rate: Scans every 500ms in a background thread.
+// WinEvents are used instead of UIA event handlers: they need no COM
+// callback objects, fire for every Win32/WPF/Chromium window, and UIA's
+// own Win32 proxy is built on them anyway.
+//
+// Latency: events are coalesced for 15 ms; a full top-level resync runs
+// every 5 s to catch anything the hooks missed.
 // ───────────────────────────────────────────────────────────────────────────
 
-using System.Collections.Concurrent;
 using System.Runtime.InteropServices;
 using Microsoft.Extensions.Logging;
 using TADBridge.Shared;
@@ -45,202 +53,448 @@ public sealed class PrivacyRedactor : IDisposable
 {
     private readonly ILogger<PrivacyRedactor> _log;
 
-    // Thread-safe list of current redaction rectangles
-    private volatile List<RedactionRect> _currentRects = new();
+    private readonly RedactionCache _cache;
+    private RedactionEngine? _engine;
+    private UiaWindowQuery? _query;
     private CancellationTokenSource? _cts;
     private Task? _scanTask;
 
     // Expansion margin around detected password fields (pixels)
     private const int MarginPx = 4;
-    private const int ScanIntervalMs = 500;
+    private static readonly TimeSpan ResyncInterval = TimeSpan.FromSeconds(5);
+    private static readonly TimeSpan CoalesceDelay = TimeSpan.FromMilliseconds(15);
 
     // Configurable redaction categories
     public RedactionCategory ActiveCategories { get; set; } = RedactionCategory.PasswordFields;
 
-    // Statistics
-    private long _totalScans;
-    private long _totalFieldsFound;
+    /// <summary>
+    /// Rendering of redacted regions in CPU-side frames (snapshots). The GPU
+    /// path always fills, since ClearTextureRegion has no blur.
+    /// </summary>
+    public RedactionStyle Style { get; set; } = RedactionStyle.Fill;
 
-    /// <summary>Total number of UIAutomation scans performed.</summary>
-    public long TotalScans => Interlocked.Read(ref _totalScans);
-    /// <summary>Total number of password fields detected across all scans.</summary>
-    public long TotalFieldsFound => Interlocked.Read(ref _totalFieldsFound);
+    /// <summary>Total number of scoped per-window UIAutomation queries performed.</summary>
+    public long TotalScans => _engine?.WindowQueries ?? 0;
+    /// <summary>Total number of password fields detected across all queries.</summary>
+    public long TotalFieldsFound => _query?.FieldsFound ?? 0;
+    /// <summary>Total number of window events received from the hooks.</summary>
+    public long TotalEvents => _engine?.EventsReceived ?? 0;
 
     public PrivacyRedactor(ILogger<PrivacyRedactor> log)
     {
         _log = log;
+        _cache = new RedactionCache(MarginPx);
         Start();
     }
 
     // ─── Public API ───────────────────────────────────────────────────
 
+    /// <summary>
+    /// Newest versioned set of screen regions to redact.
+    /// Thread-safe, non-blocking; compare <see cref="RedactionSnapshot.Version"/>
+    /// to detect changes.
+    /// </summary>
+    public RedactionSnapshot Snapshot =>
+        ActiveCategories.HasFlag(RedactionCategory.PasswordFields)
+            ? _cache.Snapshot
+            : RedactionSnapshot.Empty;
+
     /// <summary>
     /// Returns the current list of screen regions to redact.
     /// Thread-safe, non-blocking.
     /// </summary>
-    public IReadOnlyList<RedactionRect> GetRedactionRects() => _currentRects;
+    public IReadOnlyList<RedactionRect> GetRedactionRects() => Snapshot.Rects;
+
+    /// <summary>
+    /// Redact a system-memory BGRA frame in place. <paramref name="originX"/>
+    /// / <paramref name="originY"/> are the screen coordinates of the
+    /// buffer's top-left pixel. Returns the number of regions redacted.
+    /// </summary>
+    public int Redact(Span<byte> pixels, int width, int height, int stride, int originX = 0, int originY = 0)
+    {
+        var rects = Snapshot.Rects;
+        if (rects.Count == 0) return 0;
+        return RedactionKernel.Apply(pixels, width, height, stride, rects, Style,
+            originX: originX, originY: originY);
+    }
 
-    // ─── Background Scanner ───────────────────────────────────────────
+    /// <summary>
+    /// Redact a 32bpp screen capture in place (GDI snapshot paths).
+    /// <paramref name="origin"/> is the screen position of the bitmap's top-left pixel.
+    /// </summary>
+    public unsafe int Redact(System.Drawing.Bitmap bmp, System.Drawing.Point origin)
+    {
+        if (Snapshot.Rects.Count == 0) return 0;
+
+        var data = bmp.LockBits(
+            new System.Drawing.Rectangle(0, 0, bmp.Width, bmp.Height),
+            System.Drawing.Imaging.ImageLockMode.ReadWrite,
+            System.Drawing.Imaging.PixelFormat.Format32bppArgb);
+        try
+        {
+            var span = new Span<byte>((void*)data.Scan0, data.Stride * data.Height);
+            return Redact(span, data.Width, data.Height, data.Stride, origin.X, origin.Y);
+        }
+        finally
+        {
+            bmp.UnlockBits(data);
+        }
+    }
+
+    // ─── Background Engine ────────────────────────────────────────────
 
     private void Start()
     {
         _cts = new CancellationTokenSource();
-        _scanTask = Task.Run(() => ScanLoop(_cts.Token));
-        _log.LogInformation("Privacy redactor started (scan interval: {Ms}ms)", ScanIntervalMs);
+        try
+        {
+            _query = new UiaWindowQuery();
+            _engine = new RedactionEngine(new WinEventSource(), _query, _cache, ResyncInterval, CoalesceDelay);
+        }
+        catch (Exception ex)
+        {
+            _log.LogWarning(ex, "Privacy redactor unavailable (UIAutomation could not be initialised)");
+            return;
+        }
+
+        _scanTask = Task.Run(() => RunEngineAsync(_engine, _cts.Token));
+        _log.LogInformation("Privacy redactor started (event-driven, resync every {Sec}s)",
+            ResyncInterval.TotalSeconds);
     }
 
-    private async Task ScanLoop(CancellationToken ct)
+    private async Task RunEngineAsync(RedactionEngine engine, CancellationToken ct)
     {
         while (!ct.IsCancellationRequested)
         {
             try
             {
-                var rects = new List<RedactionRect>();
-
-                // Category: Password fields via UIAutomation
-                if (ActiveCategories.HasFlag(RedactionCategory.PasswordFields))
-                {
-                    var pwdRects = ScanForPasswordFields();
-                    rects.AddRange(pwdRects);
-                }
-
-                // Future: OCR-based categories (CreditCards, EmailAddresses)
-                // would scan the DXGI texture directly via DirectML/WinRT OCR
-
-                Interlocked.Increment(ref _totalScans);
-                Interlocked.Add(ref _totalFieldsFound, rects.Count);
-
-                // Atomic swap — no lock needed, readers see consistent snapshot
-                _currentRects = rects;
+                await engine.RunAsync(ct);
             }
+            catch (OperationCanceledException) { break; }
             catch (Exception ex)
             {
-                _log.LogWarning(ex, "Privacy scan error");
+                _log.LogWarning(ex, "Privacy redaction engine error — restarting");
+                try { await Task.Delay(1000, ct); } catch (OperationCanceledException) { break; }
             }
+        }
+    }
+
+    public void Dispose()
+    {
+        _cts?.Cancel();
+        try { _scanTask?.Wait(TimeSpan.FromSeconds(2)); }
+        catch (AggregateException) { }
+        catch (OperationCanceledException) { }
+        _engine?.Dispose();
+        _query?.Dispose();
+        _cts?.Dispose();
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Windows Event Source — SetWinEventHook on a dedicated message-loop thread
+// ═══════════════════════════════════════════════════════════════════════════
+
+file sealed class WinEventSource : IRedactionEventSource
+{
+    private const uint EVENT_SYSTEM_FOREGROUND    = 0x0003;
+    private const uint EVENT_OBJECT_CREATE        = 0x8000;
+    private const uint EVENT_OBJECT_DESTROY       = 0x8001;
+    private const uint EVENT_OBJECT_SHOW          = 0x8002;
+    private const uint EVENT_OBJECT_HIDE          = 0x8003;
+    private const uint EVENT_OBJECT_REORDER       = 0x8004;
+    private const uint EVENT_OBJECT_FOCUS         = 0x8005;
+    private const uint EVENT_OBJECT_LOCATIONCHANGE = 0x800B;
+
+    private const int OBJID_WINDOW = 0;
+    private const int OBJID_CARET  = -8;
+    private const int OBJID_CURSOR = -9;
+    private const int CHILDID_SELF = 0;
+
+    private const uint WINEVENT_OUTOFCONTEXT   = 0x0000;
+    private const uint WINEVENT_SKIPOWNPROCESS = 0x0002;
+    private const uint GA_ROOT = 2;
+    private const uint WM_QUIT = 0x0012;
+
+    private readonly WinEventDelegate _callback; // Must outlive the hooks
+    private Thread? _thread;
+    private uint _threadId;
+
+    public event Action<nint, WindowChangeKind>? WindowChanged;
+
+    public WinEventSource()
+    {
+        _callback = OnWinEvent;
+    }
+
+    public void Start()
+    {
+        if (_thread != null) return;
+        using var ready = new ManualResetEventSlim();
+        _thread = new Thread(() => HookThread(ready)) { IsBackground = true, Name = "TAD-RedactionHooks" };
+        _thread.Start();
+        ready.Wait(TimeSpan.FromSeconds(2));
+    }
+
+    private void HookThread(ManualResetEventSlim ready)
+    {
+        _threadId = GetCurrentThreadId();
+        uint flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+        var hooks = new[]
+        {
+            SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, 0, _callback, 0, 0, flags),
+            SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_FOCUS, 0, _callback, 0, 0, flags),
+            SetWinEventHook(EVENT_OBJECT_LOCATIONCHANGE, EVENT_OBJECT_LOCATIONCHANGE, 0, _callback, 0, 0, flags)
+        };
+        ready.Set();
 
-            await Task.Delay(ScanIntervalMs, ct);
+        // Out-of-context hooks are delivered through this thread's message queue
+        while (GetMessage(out var msg, 0, 0, 0) > 0)
+        {
+            TranslateMessage(ref msg);
+            DispatchMessage(ref msg);
         }
+
+        foreach (var h in hooks)
+            if (h != 0) UnhookWinEvent(h);
     }
 
-    // ─── UIAutomation Scanner ─────────────────────────────────────────
+    private void OnWinEvent(nint hook, uint evt, nint hwnd, int idObject, int idChild, uint thread, uint time)
+    {
+        if (hwnd == 0 || idObject == OBJID_CARET || idObject == OBJID_CURSOR) return;
 
-    /// <summary>
-    /// Uses the Windows UIAutomation COM API to find all password input
-    /// fields currently visible on screen.
-    ///
-    /// Strategy:
-    ///   1. Get the root automation element (desktop)
-    ///   2. Find all Edit controls where IsPassword == true
-    ///   3. Get their bounding rectangles in screen coordinates
-    ///   4. Add a small margin for visual safety
-    ///
-    /// The returned rectangles are passed to ScreenCaptureEngine, which
-    /// calls NativeDxgi.ClearTextureRegion() to draw solid black over
-    /// those pixel regions in the D3D11 texture BEFORE submission to
-    /// the QuickSync H.264 encoder. The teacher never sees the raw pixels.
-    ///
-    /// Detected control types:
-    ///   - Win32 edit controls with ES_PASSWORD style
-    ///   - WPF PasswordBox controls
-    ///   - Browser password fields (WebView2/Chrome UIA exposure)
-    ///   - UWP/WinUI PasswordBox controls
-    /// </summary>
-    private List<RedactionRect> ScanForPasswordFields()
+        nint root = GetAncestor(hwnd, GA_ROOT);
+        if (root == 0) root = hwnd;
+        bool isTopLevelSelf = hwnd == root && idObject == OBJID_WINDOW && idChild == CHILDID_SELF;
+
+        WindowChangeKind kind;
+        switch (evt)
+        {
+            case EVENT_SYSTEM_FOREGROUND:
+            case EVENT_OBJECT_FOCUS:
+                kind = WindowChangeKind.Focus;
+                break;
+            case EVENT_OBJECT_DESTROY when isTopLevelSelf:
+                kind = WindowChangeKind.Destroyed;
+                break;
+            case EVENT_OBJECT_LOCATIONCHANGE:
+                kind = isTopLevelSelf ? WindowChangeKind.Moved : WindowChangeKind.ContentMoved;
+                break;
+            case EVENT_OBJECT_CREATE:
+            case EVENT_OBJECT_DESTROY:
+            case EVENT_OBJECT_SHOW:
+            case EVENT_OBJECT_HIDE:
+            case EVENT_OBJECT_REORDER:
+                kind = WindowChangeKind.Structure;
+                break;
+            default:
+                return;
+        }
+
+        try { WindowChanged?.Invoke(root, kind); }
+        catch { /* Never let an exception unwind into user32 */ }
+    }
+
+    public void Dispose()
     {
-        var results = new List<RedactionRect>();
+        if (_threadId != 0) PostThreadMessage(_threadId, WM_QUIT, 0, 0);
+        _thread?.Join(TimeSpan.FromSeconds(1));
+        _thread = null;
+    }
+
+    private delegate void WinEventDelegate(
+        nint hWinEventHook, uint eventType, nint hwnd, int idObject, int idChild,
+        uint dwEventThread, uint dwmsEventTime);
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct MSG
+    {
+        public nint hwnd;
+        public uint message;
+        public nint wParam;
+        public nint lParam;
+        public uint time;
+        public int ptX, ptY;
+    }
+
+    [DllImport("user32.dll")]
+    private static extern nint SetWinEventHook(uint eventMin, uint eventMax, nint hmodWinEventProc,
+        WinEventDelegate lpfnWinEventProc, uint idProcess, uint idThread, uint dwFlags);
+
+    [DllImport("user32.dll")]
+    private static extern bool UnhookWinEvent(nint hWinEventHook);
+
+    [DllImport("user32.dll")]
+    private static extern nint GetAncestor(nint hwnd, uint gaFlags);
+
+    [DllImport("user32.dll")]
+    private static extern int GetMessage(out MSG lpMsg, nint hWnd, uint wMsgFilterMin, uint wMsgFilterMax);
+
+    [DllImport("user32.dll")]
+    private static extern bool TranslateMessage(ref MSG lpMsg);
+
+    [DllImport("user32.dll")]
+    private static extern nint DispatchMessage(ref MSG lpMsg);
 
-        // Initialize UIAutomation COM interface
+    [DllImport("user32.dll")]
+    private static extern bool PostThreadMessage(uint idThread, uint msg, nint wParam, nint lParam);
+
+    [DllImport("kernel32.dll")]
+    private static extern uint GetCurrentThreadId();
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// UIAutomation Window Query — scoped FindAll under one top-level window
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// <summary>
+/// Finds password input fields inside a single top-level window.
+///
+/// Strategy:
+///   1. IUIAutomation::ElementFromHandle(hwnd) — the window's UIA element
+///   2. FindAll(Descendants, ControlType == Edit AND IsPassword == true)
+///   3. Get their bounding rectangles in screen coordinates
+///
+/// The IUIAutomation instance and the condition are created once and
+/// reused for every query.
+///
+/// Detected control types:
+///   - Win32 edit controls with ES_PASSWORD style
+///   - WPF PasswordBox controls
+///   - Browser password fields (WebView2/Chrome UIA exposure)
+///   - UWP/WinUI PasswordBox controls
+/// </summary>
+internal sealed class UiaWindowQuery : IRedactionQuery, IDisposable
+{
+    private nint _automation;
+    private nint _condition;
+    private long _fieldsFound;
+
+    public long FieldsFound => Interlocked.Read(ref _fieldsFound);
+
+    public UiaWindowQuery()
+    {
         int hr = UiaInterop.CoCreateInstance(
             ref UiaInterop.CLSID_CUIAutomation,
             IntPtr.Zero,
             1, // CLSCTX_INPROC_SERVER
             ref UiaInterop.IID_IUIAutomation,
             out IntPtr pAutomation);
+        Marshal.ThrowExceptionForHR(hr);
+        _automation = pAutomation;
+
+        _condition = UiaInterop.CreatePasswordCondition(_automation);
+        if (_condition == 0)
+            throw new InvalidOperationException("Could not create UIAutomation password condition");
+    }
+
+    public List<RedactionRect>? QueryWindow(nint hwnd)
+    {
+        if (!IsWindow(hwnd)) return null;
+
+        var results = new List<RedactionRect>();
+        if (!IsWindowVisible(hwnd) || IsIconic(hwnd)) return results;
 
-        if (hr != 0 || pAutomation == IntPtr.Zero)
-            return results;
+        IntPtr element = UiaInterop.ElementFromHandle(_automation, hwnd);
+        if (element == IntPtr.Zero) return results;
 
         try
         {
-            // Get root element (desktop)
-            IntPtr rootElement = UiaInterop.GetRootElement(pAutomation);
-            if (rootElement == IntPtr.Zero) return results;
+            IntPtr elementArray = UiaInterop.FindAll(element, _condition);
+            if (elementArray == IntPtr.Zero) return results;
 
             try
             {
-                // Create condition: ControlType == Edit AND IsPassword == true
-                IntPtr condition = UiaInterop.CreatePasswordCondition(pAutomation);
-                if (condition == IntPtr.Zero) return results;
-
-                try
+                int count = UiaInterop.GetArrayLength(elementArray);
+                for (int i = 0; i < count; i++)
                 {
-                    // FindAll with TreeScope_Descendants
-                    IntPtr elementArray = UiaInterop.FindAll(rootElement, condition);
-                    if (elementArray == IntPtr.Zero) return results;
+                    IntPtr field = UiaInterop.GetArrayElement(elementArray, i);
+                    if (field == IntPtr.Zero) continue;
 
                     try
                     {
-                        int count = UiaInterop.GetArrayLength(elementArray);
-
-                        for (int i = 0; i < count; i++)
+                        var rect = UiaInterop.GetBoundingRectangle(field);
+                        if (rect.Width > 0 && rect.Height > 0)
                         {
-                            IntPtr element = UiaInterop.GetArrayElement(elementArray, i);
-                            if (element == IntPtr.Zero) continue;
-
-                            try
-                            {
-                                var rect = UiaInterop.GetBoundingRectangle(element);
-                                if (rect.Width > 0 && rect.Height > 0)
-                                {
-                                    results.Add(new RedactionRect
-                                    {
-                                        X = Math.Max(0, rect.X - MarginPx),
-                                        Y = Math.Max(0, rect.Y - MarginPx),
-                                        Width = rect.Width + MarginPx * 2,
-                                        Height = rect.Height + MarginPx * 2
-                                    });
-                                }
-                            }
-                            finally
+                            results.Add(new RedactionRect
                             {
-                                Marshal.Release(element);
-                            }
+                                X = rect.X,
+                                Y = rect.Y,
+                                Width = rect.Width,
+                                Height = rect.Height
+                            });
                         }
                     }
                     finally
                     {
-                        Marshal.Release(elementArray);
+                        Marshal.Release(field);
                     }
                 }
-                finally
-                {
-                    Marshal.Release(condition);
-                }
             }
             finally
             {
-                Marshal.Release(rootElement);
+                Marshal.Release(elementArray);
             }
         }
         finally
         {
-            Marshal.Release(pAutomation);
+            Marshal.Release(element);
         }
 
-        if (results.Count > 0)
-            _log.LogDebug("Privacy redactor found {Count} password fields", results.Count);
-
+        Interlocked.Add(ref _fieldsFound, results.Count);
         return results;
     }
 
+    public bool TryGetWindowBounds(nint hwnd, out RedactionRect bounds)
+    {
+        bounds = default;
+        if (!GetWindowRect(hwnd, out var r)) return false;
+        bounds = new RedactionRect
+        {
+            X = r.Left,
+            Y = r.Top,
+            Width = r.Right - r.Left,
+            Height = r.Bottom - r.Top
+        };
+        return true;
+    }
+
+    public IReadOnlyCollection<nint> EnumerateWindows()
+    {
+        var list = new List<nint>();
+        EnumWindows((hwnd, _) =>
+        {
+            if (IsWindowVisible(hwnd)) list.Add(hwnd);
+            return true;
+        }, 0);
+        return list;
+    }
+
     public void Dispose()
     {
-        _cts?.Cancel();
-        try { _scanTask?.Wait(TimeSpan.FromSeconds(2)); }
-        catch (AggregateException) { }
-        catch (OperationCanceledException) { }
-        _cts?.Dispose();
+        if (_condition != 0) { Marshal.Release(_condition); _condition = 0; }
+        if (_automation != 0) { Marshal.Release(_automation); _automation = 0; }
     }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct WINRECT { public int Left, Top, Right, Bottom; }
+
+    private delegate bool EnumWindowsProc(nint hwnd, nint lParam);
+
+    [DllImport("user32.dll")]
+    private static extern bool EnumWindows(EnumWindowsProc lpEnumFunc, nint lParam);
+
+    [DllImport("user32.dll")]
+    private static extern bool IsWindow(nint hwnd);
+
+    [DllImport("user32.dll")]
+    private static extern bool IsWindowVisible(nint hwnd);
+
+    [DllImport("user32.dll")]
+    private static extern bool IsIconic(nint hwnd);
+
+    [DllImport("user32.dll")]
+    private static extern bool GetWindowRect(nint hwnd, out WINRECT rect);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -279,6 +533,16 @@ file static class UiaInterop
     }
     private delegate int GetRootElementDelegate(IntPtr self, out IntPtr root);
 
+    /// <summary>IUIAutomation::ElementFromHandle (vtable slot 6)</summary>
+    public static IntPtr ElementFromHandle(IntPtr automation, IntPtr hwnd)
+    {
+        var vtable = Marshal.ReadIntPtr(Marshal.ReadIntPtr(automation) + 6 * IntPtr.Size);
+        var fn = Marshal.GetDelegateForFunctionPointer<ElementFromHandleDelegate>(vtable);
+        fn(automation, hwnd, out IntPtr element);
+        return element;
+    }
+    private delegate int ElementFromHandleDelegate(IntPtr self, IntPtr hwnd, out IntPtr element);
+
     /// <summary>
     /// Create an AND condition: ControlType==Edit AND IsPassword==True
     /// </summary>
@@ -0,0 +1,418 @@
+// ───────────────────────────────────────────────────────────────────────────
+// RedactionEngine.cs — Event-driven, per-window redaction rectangle cache
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// Replaces the "FindAll from the desktop root every 500 ms" scan:
+//
+//   window events (focus / structure / location)
+//     → RedactionCache marks the affected top-level window dirty
+//     → RedactionEngine re-queries ONLY the dirty windows (coalesced)
+//     → cache publishes an immutable, versioned RedactionSnapshot
+//     → ScreenCaptureEngine reads the newest snapshot every frame
+//
+// A slow periodic resync catches windows whose events were missed.
+//
+// Everything in this file is platform-neutral. The Windows event source
+// (SetWinEventHook) and the UIAutomation query live in PrivacyRedactor.cs;
+// tests and tools can drive the engine with a fake IRedactionEventSource /
+// IRedactionQuery.
+// ───────────────────────────────────────────────────────────────────────────
+
+using TADBridge.Shared;
+
+namespace TADBridge.Capture;
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Abstractions
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// <summary>What happened to a top-level window.</summary>
+public enum WindowChangeKind
+{
+    /// <summary>Keyboard focus or foreground moved into the window.</summary>
+    Focus,
+    /// <summary>Elements created, destroyed, shown, hidden or reordered.</summary>
+    Structure,
+    /// <summary>The top-level window itself moved or resized.</summary>
+    Moved,
+    /// <summary>Something inside the window moved (scroll, layout).</summary>
+    ContentMoved,
+    /// <summary>The top-level window was destroyed.</summary>
+    Destroyed
+}
+
+/// <summary>Source of window change notifications (SetWinEventHook on Windows).</summary>
+public interface IRedactionEventSource : IDisposable
+{
+    /// <summary>Raised with the top-level window handle. May fire on any thread.</summary>
+    event Action<nint, WindowChangeKind>? WindowChanged;
+
+    void Start();
+}
+
+/// <summary>Scoped queries against the accessibility tree.</summary>
+public interface IRedactionQuery
+{
+    /// <summary>
+    /// Sensitive element rectangles inside one top-level window, in screen
+    /// coordinates and without margin. Returns null if the window is gone.
+    /// </summary>
+    List<RedactionRect>? QueryWindow(nint hwnd);
+
+    /// <summary>Current screen bounds of a top-level window.</summary>
+    bool TryGetWindowBounds(nint hwnd, out RedactionRect bounds);
+
+    /// <summary>All visible top-level windows (used by the periodic resync).</summary>
+    IReadOnlyCollection<nint> EnumerateWindows();
+}
+
+/// <summary>Immutable set of rectangles to redact, stamped with a version.</summary>
+public sealed class RedactionSnapshot
+{
+    public static readonly RedactionSnapshot Empty = new(0, Array.Empty<RedactionRect>());
+
+    /// <summary>Increments every time the set of rectangles changes.</summary>
+    public long Version { get; }
+    public IReadOnlyList<RedactionRect> Rects { get; }
+
+    public RedactionSnapshot(long version, IReadOnlyList<RedactionRect> rects)
+    {
+        Version = version;
+        Rects = rects;
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Redaction Cache
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// <summary>
+/// Per-window cache of sensitive rectangles plus the set of windows that
+/// need re-querying. A dirty window keeps its old rectangles until the new
+/// query result arrives, so a change never un-redacts a field early.
+/// </summary>
+public sealed class RedactionCache
+{
+    private readonly object _lock = new();
+    private readonly Dictionary<nint, Entry> _windows = new();
+    private readonly HashSet<nint> _dirty = new();
+    private readonly int _marginPx;
+    private long _version;
+    private volatile RedactionSnapshot _snapshot = RedactionSnapshot.Empty;
+
+    public RedactionCache(int marginPx)
+    {
+        _marginPx = marginPx;
+    }
+
+    /// <summary>Newest published snapshot. Lock-free read.</summary>
+    public RedactionSnapshot Snapshot => _snapshot;
+
+    public int WindowCount
+    {
+        get { lock (_lock) return _windows.Count; }
+    }
+
+    public int DirtyCount
+    {
+        get { lock (_lock) return _dirty.Count; }
+    }
+
+    /// <summary>True when the window currently contributes at least one rectangle.</summary>
+    public bool HasRects(nint hwnd)
+    {
+        lock (_lock) return _windows.TryGetValue(hwnd, out var e) && e.Rects.Length > 0;
+    }
+
+    public void MarkDirty(nint hwnd)
+    {
+        lock (_lock) _dirty.Add(hwnd);
+    }
+
+    /// <summary>
+    /// A top-level window moved. Same size → shift its cached rectangles by
+    /// the delta and publish at once (no query). Resized → re-query.
+    /// </summary>
+    public void OnWindowMoved(nint hwnd, RedactionRect newBounds)
+    {
+        lock (_lock)
+        {
+            if (!_windows.TryGetValue(hwnd, out var e))
+            {
+                _dirty.Add(hwnd);
+                return;
+            }
+
+            var old = e.Bounds;
+            if (old.Width != newBounds.Width || old.Height != newBounds.Height)
+            {
+                _dirty.Add(hwnd);
+                return;
+            }
+
+            int dx = newBounds.X - old.X, dy = newBounds.Y - old.Y;
+            if (dx == 0 && dy == 0) return;
+
+            var moved = new RedactionRect[e.Rects.Length];
+            for (int i = 0; i < moved.Length; i++)
+            {
+                var r = e.Rects[i];
+                moved[i] = new RedactionRect
+                {
+                    X = Math.Max(0, r.X + dx),
+                    Y = Math.Max(0, r.Y + dy),
+                    Width = r.Width,
+                    Height = r.Height
+                };
+            }
+            _windows[hwnd] = new Entry(newBounds, moved);
+            if (moved.Length > 0) PublishLocked();
+        }
+    }
+
+    /// <summary>Forget a destroyed window.</summary>
+    public void Remove(nint hwnd)
+    {
+        lock (_lock)
+        {
+            _dirty.Remove(hwnd);
+            if (_windows.Remove(hwnd, out var e) && e.Rects.Length > 0)
+                PublishLocked();
+        }
+    }
+
+    /// <summary>Take (and clear) the set of windows waiting for a query.</summary>
+    public List<nint> TakeDirty()
+    {
+        lock (_lock)
+        {
+            var list = new List<nint>(_dirty);
+            _dirty.Clear();
+            return list;
+        }
+    }
+
+    /// <summary>
+    /// Store a fresh query result for one window. Publishes a new snapshot
+    /// only if the window's rectangles actually changed.
+    /// </summary>
+    public void Update(nint hwnd, RedactionRect bounds, IReadOnlyList<RedactionRect> rawRects)
+    {
+        var rects = new RedactionRect[rawRects.Count];
+        for (int i = 0; i < rects.Length; i++)
+        {
+            var r = rawRects[i];
+            rects[i] = new RedactionRect
+            {
+                X = Math.Max(0, r.X - _marginPx),
+                Y = Math.Max(0, r.Y - _marginPx),
+                Width = r.Width + _marginPx * 2,
+                Height = r.Height + _marginPx * 2
+            };
+        }
+
+        lock (_lock)
+        {
+            bool changed = _windows.TryGetValue(hwnd, out var old)
+                ? !SameRects(old.Rects, rects)
+                : rects.Length > 0;
+            _windows[hwnd] = new Entry(bounds, rects);
+            if (changed) PublishLocked();
+        }
+    }
+
+    /// <summary>
+    /// Reconcile with the full list of live top-level windows: drop vanished
+    /// windows, mark unknown ones dirty.
+    /// </summary>
+    public void Resync(IReadOnlyCollection<nint> liveWindows)
+    {
+        var live = new HashSet<nint>(liveWindows);
+        lock (_lock)
+        {
+            bool removedAny = false;
+            foreach (var hwnd in _windows.Keys.ToList())
+            {
+                if (live.Contains(hwnd)) continue;
+                removedAny |= _windows[hwnd].Rects.Length > 0;
+                _windows.Remove(hwnd);
+                _dirty.Remove(hwnd);
+            }
+
+            foreach (var hwnd in live)
+                if (!_windows.ContainsKey(hwnd))
+                    _dirty.Add(hwnd);
+
+            if (removedAny) PublishLocked();
+        }
+    }
+
+    private void PublishLocked()
+    {
+        var all = new List<RedactionRect>();
+        foreach (var e in _windows.Values)
+            all.AddRange(e.Rects);
+        _snapshot = new RedactionSnapshot(++_version, all);
+    }
+
+    private static bool SameRects(RedactionRect[] a, RedactionRect[] b)
+    {
+        if (a.Length != b.Length) return false;
+        for (int i = 0; i < a.Length; i++)
+        {
+            if (a[i].X != b[i].X || a[i].Y != b[i].Y
+                || a[i].Width != b[i].Width || a[i].Height != b[i].Height)
+                return false;
+        }
+        return true;
+    }
+
+    private readonly record struct Entry(RedactionRect Bounds, RedactionRect[] Rects);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Redaction Engine — events → dirty windows → scoped queries
+// ═══════════════════════════════════════════════════════════════════════════
+
+public sealed class RedactionEngine : IDisposable
+{
+    private readonly IRedactionEventSource _source;
+    private readonly IRedactionQuery _query;
+    private readonly RedactionCache _cache;
+    private readonly TimeSpan _resyncInterval;
+    private readonly TimeSpan _coalesce;
+    private readonly SemaphoreSlim _signal = new(0);
+    private int _signalPending;
+
+    private long _eventsReceived;
+    private long _windowQueries;
+
+    public RedactionCache Cache => _cache;
+
+    /// <summary>Window events received from the source.</summary>
+    public long EventsReceived => Interlocked.Read(ref _eventsReceived);
+
+    /// <summary>Scoped per-window queries executed.</summary>
+    public long WindowQueries => Interlocked.Read(ref _windowQueries);
+
+    /// <param name="resyncInterval">Full top-level window reconciliation period.</param>
+    /// <param name="coalesce">Delay after the first event so bursts collapse into one query per window.</param>
+    public RedactionEngine(
+        IRedactionEventSource source,
+        IRedactionQuery query,
+        RedactionCache cache,
+        TimeSpan resyncInterval,
+        TimeSpan coalesce)
+    {
+        _source = source;
+        _query = query;
+        _cache = cache;
+        _resyncInterval = resyncInterval;
+        _coalesce = coalesce;
+        _source.WindowChanged += OnWindowChanged;
+    }
+
+    // ─── Event Intake (any thread) ────────────────────────────────────
+
+    private void OnWindowChanged(nint hwnd, WindowChangeKind kind)
+    {
+        Interlocked.Increment(ref _eventsReceived);
+
+        switch (kind)
+        {
+            case WindowChangeKind.Destroyed:
+                _cache.Remove(hwnd);
+                return; // Nothing to query
+
+            case WindowChangeKind.Moved:
+                if (_query.TryGetWindowBounds(hwnd, out var bounds))
+                    _cache.OnWindowMoved(hwnd, bounds);
+                else
+                    _cache.MarkDirty(hwnd);
+                break;
+
+            case WindowChangeKind.ContentMoved:
+                // Scrolling only matters where a sensitive field is already
+                // known; new fields announce themselves via Structure/Focus.
+                if (!_cache.HasRects(hwnd)) return;
+                _cache.MarkDirty(hwnd);
+                break;
+
+            default:
+                _cache.MarkDirty(hwnd);
+                break;
+        }
+
+        Signal();
+    }
+
+    private void Signal()
+    {
+        if (Interlocked.Exchange(ref _signalPending, 1) == 0)
+            _signal.Release();
+    }
+
+    // ─── Processing ───────────────────────────────────────────────────
+
+    /// <summary>Query every dirty window once. Returns the number of windows queried.</summary>
+    public int ProcessPending()
+    {
+        var dirty = _cache.TakeDirty();
+        foreach (var hwnd in dirty)
+        {
+            Interlocked.Increment(ref _windowQueries);
+            var rects = _query.QueryWindow(hwnd);
+            if (rects == null || !_query.TryGetWindowBounds(hwnd, out var bounds))
+            {
+                _cache.Remove(hwnd);
+                continue;
+            }
+            _cache.Update(hwnd, bounds, rects);
+        }
+        return dirty.Count;
+    }
+
+    /// <summary>Reconcile with all live top-level windows, then query the new ones.</summary>
+    public int Resync()
+    {
+        _cache.Resync(_query.EnumerateWindows());
+        return ProcessPending();
+    }
+
+    /// <summary>Start the event source and process changes until cancelled.</summary>
+    public async Task RunAsync(CancellationToken ct)
+    {
+        _source.Start();
+        Resync();
+        var nextResync = DateTime.UtcNow + _resyncInterval;
+
+        while (!ct.IsCancellationRequested)
+        {
+            var wait = nextResync - DateTime.UtcNow;
+            bool signalled = wait > TimeSpan.Zero && await _signal.WaitAsync(wait, ct);
+
+            if (signalled)
+            {
+                // Let the burst that triggered us finish before querying
+                if (_coalesce > TimeSpan.Zero)
+                    await Task.Delay(_coalesce, ct);
+                Volatile.Write(ref _signalPending, 0);
+                ProcessPending();
+            }
+
+            if (DateTime.UtcNow >= nextResync)
+            {
+                Resync();
+                nextResync = DateTime.UtcNow + _resyncInterval;
+            }
+        }
+    }
+
+    public void Dispose()
+    {
+        _source.WindowChanged -= OnWindowChanged;
+        _source.Dispose();
+        _signal.Dispose();
+    }
+}
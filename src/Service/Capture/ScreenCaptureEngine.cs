@@ -13,11 +13,16 @@
 //         Sub-stream:  1 FPS, 480p, ~200 kbps (50-student grid)
 //         Main-stream: 30 FPS, 720p, ~3 Mbps  (focused remote view)
 //
+// Warm standby: while a teacher is connected, DXGI and both encoders stay
+// initialised (Warm/Cool) and each stream keeps its current GOP in a
+// GopCache, so RvStart/RvFocusStart can show a picture immediately.
+//
 // Target: i5-12400, UHD 730, 16GB RAM × 50 machines
 // ───────────────────────────────────────────────────────────────────────────
 
 using System.Runtime.InteropServices;
 using Microsoft.Extensions.Logging;
+using TADBridge.Shared;
 
 namespace TADBridge.Capture;
 
@@ -206,13 +211,18 @@ public sealed class QuickSyncEncoder : IDisposable
     private readonly StreamProfile _profile;
     private IntPtr _mft;
     private bool _initialized;
+    private int _bitrateKbps;
 
     public StreamProfile Profile => _profile;
 
+    /// <summary>Current target bitrate (starts at the profile value, changed by <see cref="SetBitrate"/>).</summary>
+    public int BitrateKbps => _bitrateKbps;
+
     public QuickSyncEncoder(ILogger log, StreamProfile profile)
     {
         _log = log;
         _profile = profile;
+        _bitrateKbps = profile.BitrateKbps;
     }
 
     /// <summary>
@@ -253,10 +263,12 @@ public sealed class QuickSyncEncoder : IDisposable
     }
 
     /// <summary>
-    /// Submit a DXGI texture to the encoder. Returns encoded H.264 NAL units.
+    /// Submit a DXGI texture to the encoder. Returns the encoded H.264 NAL
+    /// units in a pooled frame buffer (header space reserved) that the caller
+    /// owns and must <see cref="TadFrameBuffer.Release"/>.
     /// The texture is downscaled to the profile resolution.
     /// </summary>
-    public byte[]? Encode(IntPtr d3dDevice, IntPtr sourceTexture, bool forceKeyFrame)
+    public TadFrameBuffer? Encode(IntPtr d3dDevice, IntPtr sourceTexture, bool forceKeyFrame)
     {
         if (!_initialized || _mft == IntPtr.Zero) return null;
 
@@ -279,6 +291,18 @@ public sealed class QuickSyncEncoder : IDisposable
             NativeMft.ForceKeyFrame(_mft);
     }
 
+    /// <summary>
+    /// Change the mean bitrate on the fly (no encoder restart, no IDR).
+    /// Takes effect from the next submitted frame.
+    /// </summary>
+    public void SetBitrate(int kbps)
+    {
+        if (kbps <= 0 || kbps == _bitrateKbps) return;
+        _bitrateKbps = kbps;
+        if (_mft != IntPtr.Zero)
+            NativeMft.SetBitrate(_mft, kbps);
+    }
+
     public void Dispose()
     {
         if (_mft != IntPtr.Zero)
@@ -308,8 +332,12 @@ public sealed class ScreenCaptureEngine : IDisposable
     private readonly PrivacyRedactor _redactor;
 
     private CancellationTokenSource? _cts;
+    private CancellationTokenSource? _mainCts;
     private Task? _subStreamTask;      // Always running: 1 fps thumbnail
     private Task? _mainStreamTask;     // On-demand: 30 fps focused view
+    private bool _warm;                // DXGI + encoders initialised
+    private readonly object _lifecycleLock = new();
+    private volatile bool _subKeyFrameRequested;
 
     // DXGI handles
     private IntPtr _d3dDevice;
@@ -331,18 +359,53 @@ public sealed class ScreenCaptureEngine : IDisposable
     private int _screenWidth = 1920;
     private int _screenHeight = 1080;
 
+    // Sub-stream target — adjusted by the teacher's bandwidth allocator (RvSetTarget)
+    private volatile int _subIntervalMs = 1000 / StreamProfiles.SubStream.Fps;
+    private volatile int _subBitrateKbps = StreamProfiles.SubStream.BitrateKbps;
+    private double _dirtyRatioSmoothed;
+
+    /// <summary>Bounds applied to allocator targets so a bad message cannot starve or flood the link.</summary>
+    public const int MinSubIntervalMs = 200;      // 5 fps ceiling
+    public const int MaxSubIntervalMs = 10_000;   // 0.1 fps floor
+    public const int MinSubBitrateKbps = 30;
+    public const int MaxSubBitrateKbps = 800;
+
+    // Frame callbacks receive a pooled buffer that is only valid for the
+    // duration of the call — AddRef() it to keep it longer.
+
     /// <summary>Callback for sub-stream frames (1 fps thumbnail for grid).</summary>
-    public Action<byte[], bool>? OnSubFrameEncoded { get; set; }
+    public Action<TadFrameBuffer, bool>? OnSubFrameEncoded { get; set; }
 
     /// <summary>Callback for main-stream frames (30 fps focused view).</summary>
-    public Action<byte[], bool>? OnMainFrameEncoded { get; set; }
+    public Action<TadFrameBuffer, bool>? OnMainFrameEncoded { get; set; }
 
     /// <summary>Legacy callback — wired to sub-stream for backwards compatibility.</summary>
-    public Action<byte[], bool>? OnFrameEncoded { get; set; }
+    public Action<TadFrameBuffer, bool>? OnFrameEncoded { get; set; }
+
+    /// <summary>Current sub-stream GOP (≤ 5 s at up to 5 fps).</summary>
+    public GopCache SubGop { get; } = new(maxFrames: 32, maxBytes: 2 * 1024 * 1024);
+
+    /// <summary>Current main-stream GOP (2 s at 30 fps).</summary>
+    public GopCache MainGop { get; } = new(maxFrames: 90, maxBytes: 4 * 1024 * 1024);
+
+    /// <summary>True while DXGI and the encoders are initialised.</summary>
+    public bool IsWarm => _warm;
 
     /// <summary>True when main-stream (30 fps) is active.</summary>
     public bool IsMainStreamActive => _mainStreamTask != null;
 
+    /// <summary>
+    /// Smoothed fraction of the screen that changed per sub-stream tick (0.0–1.0).
+    /// Reported in <c>StudentStatus.DirtyRatio</c> so the teacher can weight its budget.
+    /// </summary>
+    public double DirtyRatio => Volatile.Read(ref _dirtyRatioSmoothed);
+
+    /// <summary>Version of the redaction snapshot applied to the most recent frame.</summary>
+    public long LastRedactionVersion { get; private set; }
+
+    /// <summary>Current sub-stream frame interval in milliseconds.</summary>
+    public int SubStreamIntervalMs => _subIntervalMs;
+
     public ScreenCaptureEngine(ILogger<ScreenCaptureEngine> log, PrivacyRedactor redactor)
     {
         _log = log;
@@ -351,61 +414,154 @@ public sealed class ScreenCaptureEngine : IDisposable
 
     // ─── Lifecycle ────────────────────────────────────────────────────
 
-    /// <summary>Start the sub-stream (1 fps thumbnail). Always on.</summary>
-    public async Task StartAsync(CancellationToken externalCt)
+    /// <summary>
+    /// Initialise DXGI duplication and both encoders without capturing.
+    /// Called when a teacher connects so the first RvStart/RvFocusStart
+    /// does not pay for device and MFT creation. Idempotent.
+    /// </summary>
+    public void Warm()
     {
-        if (_subStreamTask != null) return;
+        lock (_lifecycleLock)
+        {
+            if (_warm) return;
+            var sw = System.Diagnostics.Stopwatch.StartNew();
+
+            InitializeDxgi();
+
+            _subEncoder = new QuickSyncEncoder(_log, StreamProfiles.SubStream);
+            _subEncoder.Initialize();
+            _subEncoder.SetBitrate(_subBitrateKbps); // Keep the last allocator target across restarts
+
+            _mainEncoder = new QuickSyncEncoder(_log, StreamProfiles.MainStream);
+            _mainEncoder.Initialize();
+
+            _dirtyTracker = new DirtyRegionTracker(_screenWidth, _screenHeight);
+            _warm = true;
+
+            _log.LogInformation("Capture pipeline warm in {Ms} ms", sw.ElapsedMilliseconds);
+        }
+    }
 
-        _cts = CancellationTokenSource.CreateLinkedTokenSource(externalCt);
-        var ct = _cts.Token;
+    /// <summary>Release DXGI and both encoders (teacher disconnected). Same as <see cref="Stop"/>.</summary>
+    public void Cool() => Stop();
 
-        InitializeDxgi();
+    /// <summary>Start the sub-stream (1 fps thumbnail). Always on.</summary>
+    public async Task StartAsync(CancellationToken externalCt)
+    {
+        lock (_lifecycleLock)
+        {
+            if (_subStreamTask != null) return;
 
-        _subEncoder = new QuickSyncEncoder(_log, StreamProfiles.SubStream);
-        _subEncoder.Initialize();
+            Warm();
 
-        _dirtyTracker = new DirtyRegionTracker(_screenWidth, _screenHeight);
+            _cts = CancellationTokenSource.CreateLinkedTokenSource(externalCt);
+            var ct = _cts.Token;
 
-        _subStreamTask = Task.Run(() => SubStreamLoop(ct), ct);
+            _subEncoder!.RequestKeyFrame();
+            _subStreamTask = Task.Run(() => SubStreamLoop(ct), ct);
+        }
         _log.LogInformation("Sub-stream started (1 fps, 480p, 200 kbps)");
         await Task.CompletedTask;
     }
 
+    /// <summary>
+    /// Stop capturing the sub-stream (and main-stream) but keep DXGI and the
+    /// encoders warm for the next RvStart.
+    /// </summary>
+    public void StopCapture()
+    {
+        Task? sub, main;
+        lock (_lifecycleLock)
+        {
+            _cts?.Cancel();
+            sub = _subStreamTask;
+            main = _mainStreamTask;
+            _subStreamTask = null;
+            _mainStreamTask = null;
+        }
+        try { sub?.Wait(TimeSpan.FromSeconds(2)); } catch (AggregateException) { }
+        try { main?.Wait(TimeSpan.FromSeconds(1)); } catch (AggregateException) { }
+        SubGop.Clear();
+        MainGop.Clear();
+        _log.LogInformation("Capture stopped (pipeline kept warm)");
+    }
+
+    /// <summary>
+    /// Make the next sub-stream frame an IDR, regardless of the keyframe
+    /// interval. Used when a new viewer joins.
+    /// </summary>
+    public void RequestSubKeyFrame()
+    {
+        _subKeyFrameRequested = true;
+        _subEncoder?.RequestKeyFrame();
+    }
+
     /// <summary>Activate the main-stream (30 fps). Called when teacher focuses a tile.</summary>
     public void StartMainStream()
     {
-        if (_mainStreamTask != null || _cts == null) return;
+        lock (_lifecycleLock)
+        {
+            if (_mainStreamTask != null || _cts == null) return;
 
-        _mainEncoder = new QuickSyncEncoder(_log, StreamProfiles.MainStream);
-        _mainEncoder.Initialize();
-        _mainEncoder.RequestKeyFrame(); // Start with IDR
+            // Normally created by Warm(); only rebuilt if something disposed it
+            if (_mainEncoder == null)
+            {
+                _mainEncoder = new QuickSyncEncoder(_log, StreamProfiles.MainStream);
+                _mainEncoder.Initialize();
+            }
+            _mainEncoder.RequestKeyFrame(); // Start with IDR
 
-        _mainStreamTask = Task.Run(() => MainStreamLoop(_cts.Token), _cts.Token);
+            _mainCts = CancellationTokenSource.CreateLinkedTokenSource(_cts.Token);
+            var ct = _mainCts.Token;
+            _mainStreamTask = Task.Run(() => MainStreamLoop(ct), ct);
+        }
         _log.LogInformation("Main-stream started (30 fps, 720p, 3 Mbps)");
     }
 
-    /// <summary>Deactivate the main-stream. Sub-stream keeps running.</summary>
+    /// <summary>
+    /// Apply a sub-stream target from the teacher. Values are clamped to
+    /// [<see cref="MinSubIntervalMs"/>, <see cref="MaxSubIntervalMs"/>] and
+    /// [<see cref="MinSubBitrateKbps"/>, <see cref="MaxSubBitrateKbps"/>].
+    /// The running loop picks up the new interval on its next tick.
+    /// </summary>
+    public void SetSubStreamTarget(int frameIntervalMs, int bitrateKbps)
+    {
+        _subIntervalMs = Math.Clamp(frameIntervalMs, MinSubIntervalMs, MaxSubIntervalMs);
+        _subBitrateKbps = Math.Clamp(bitrateKbps, MinSubBitrateKbps, MaxSubBitrateKbps);
+        _subEncoder?.SetBitrate(_subBitrateKbps);
+    }
+
+    /// <summary>
+    /// Deactivate the main-stream. Sub-stream keeps running and the main
+    /// encoder stays initialised for the next focus.
+    /// </summary>
     public void StopMainStream()
     {
-        var task = _mainStreamTask;
-        _mainEncoder?.Dispose();
-        _mainEncoder = null;
-        _mainStreamTask = null;
-        task?.Wait(TimeSpan.FromSeconds(2));
+        Task? task;
+        lock (_lifecycleLock)
+        {
+            _mainCts?.Cancel();
+            task = _mainStreamTask;
+            _mainStreamTask = null;
+        }
+        try { task?.Wait(TimeSpan.FromSeconds(2)); } catch (AggregateException) { }
+        MainGop.Clear(); // Next focus starts from a fresh IDR
         _log.LogInformation("Main-stream stopped");
     }
 
     public void Stop()
     {
-        _cts?.Cancel();
-        _subStreamTask?.Wait(TimeSpan.FromSeconds(2));
-        _mainStreamTask?.Wait(TimeSpan.FromSeconds(1));
-        _subStreamTask = null;
-        _mainStreamTask = null;
+        StopCapture();
 
-        _subEncoder?.Dispose();
-        _mainEncoder?.Dispose();
-        ReleaseNativeResources();
+        lock (_lifecycleLock)
+        {
+            _subEncoder?.Dispose();
+            _mainEncoder?.Dispose();
+            _subEncoder = null;
+            _mainEncoder = null;
+            ReleaseNativeResources();
+            _warm = false;
+        }
 
         _log.LogInformation("Capture engine stopped");
     }
@@ -415,13 +571,17 @@ public sealed class ScreenCaptureEngine : IDisposable
     private void SubStreamLoop(CancellationToken ct)
     {
         var profile = StreamProfiles.SubStream;
-        int intervalMs = 1000 / profile.Fps;
         int frameCount = 0;
-        int gopSize = profile.KeyFrameIntervalSec * profile.Fps;
+
+        // Keyframes are time-based because the frame interval is variable
+        long keyFrameIntervalMs = profile.KeyFrameIntervalSec * 1000L;
+        long lastKeyFrameMs = 0;
+        var clock = System.Diagnostics.Stopwatch.StartNew();
 
         while (!ct.IsCancellationRequested)
         {
             var sw = System.Diagnostics.Stopwatch.StartNew();
+            int intervalMs = _subIntervalMs;
 
             try
             {
@@ -450,23 +610,36 @@ public sealed class ScreenCaptureEngine : IDisposable
 
                     // Skip encode if nothing changed (save CPU/GPU)
                     double ratio = _dirtyTracker.DirtyRatio();
+                    Volatile.Write(ref _dirtyRatioSmoothed,
+                        _dirtyRatioSmoothed * 0.7 + ratio * 0.3);
                     if (ratio < 0.001 && frameCount > 0)
-                    {
-                        lock (_frameLock) { ReleaseFrame(); }
                         continue;
-                    }
 
                     // Apply privacy redaction (black out password fields in GPU)
                     ApplyPrivacyRedaction(texture);
 
                     // Encode
-                    bool keyFrame = (frameCount % gopSize) == 0;
-                    byte[]? encoded = _subEncoder!.Encode(_d3dDevice, texture, keyFrame);
+                    long nowMs = clock.ElapsedMilliseconds;
+                    bool keyFrame = frameCount == 0 || _subKeyFrameRequested
+                        || nowMs - lastKeyFrameMs >= keyFrameIntervalMs;
+                    if (keyFrame)
+                    {
+                        lastKeyFrameMs = nowMs;
+                        _subKeyFrameRequested = false;
+                    }
+                    var encoded = _subEncoder!.Encode(_d3dDevice, texture, keyFrame);
 
-                    if (encoded is { Length: > 0 })
+                    if (encoded != null)
                     {
-                        OnSubFrameEncoded?.Invoke(encoded, keyFrame);
-                        OnFrameEncoded?.Invoke(encoded, keyFrame); // Legacy compat
+                        try
+                        {
+                            if (encoded.PayloadLength > 0)
+                            {
+                                SubGop.Publish(encoded, keyFrame, OnSubFrameEncoded);
+                                OnFrameEncoded?.Invoke(encoded, keyFrame); // Legacy compat
+                            }
+                        }
+                        finally { encoded.Release(); }
                     }
                 }
                 finally
@@ -519,10 +692,17 @@ public sealed class ScreenCaptureEngine : IDisposable
                     ApplyPrivacyRedaction(texture);
 
                     bool keyFrame = (frameCount % gopSize) == 0;
-                    byte[]? encoded = _mainEncoder?.Encode(_d3dDevice, texture, keyFrame);
+                    var encoded = _mainEncoder?.Encode(_d3dDevice, texture, keyFrame);
 
-                    if (encoded is { Length: > 0 })
-                        OnMainFrameEncoded?.Invoke(encoded, keyFrame);
+                    if (encoded != null)
+                    {
+                        try
+                        {
+                            if (encoded.PayloadLength > 0)
+                                MainGop.Publish(encoded, keyFrame, OnMainFrameEncoded);
+                        }
+                        finally { encoded.Release(); }
+                    }
                 }
                 finally
                 {
@@ -617,7 +797,12 @@ public sealed class ScreenCaptureEngine : IDisposable
     /// </summary>
     private void ApplyPrivacyRedaction(IntPtr frameTexture)
     {
-        var rects = _redactor.GetRedactionRects();
+        // Read the newest snapshot per frame — a field that appeared since
+        // the previous frame is already covered by this one.
+        var snapshot = _redactor.Snapshot;
+        LastRedactionVersion = snapshot.Version;
+
+        var rects = snapshot.Rects;
         if (rects.Count == 0) return;
 
         foreach (var rect in rects)
@@ -806,15 +991,16 @@ file static class NativeMft
         // SetInputType: NV12 at same w × h
     }
 
-    /// <summary>Encode a D3D11 texture to H.264 NAL units.</summary>
-    public static byte[]? EncodeTexture(IntPtr mft, IntPtr texture, bool forceKeyFrame)
+    /// <summary>Encode a D3D11 texture to H.264 NAL units in a pooled frame buffer.</summary>
+    public static TadFrameBuffer? EncodeTexture(IntPtr mft, IntPtr texture, bool forceKeyFrame)
     {
         // 1. MFCreateDXGISurfaceBuffer(texture)
         // 2. MFCreateSample() → AddBuffer
         // 3. If forceKeyFrame: set MFSampleExtension_CleanPoint
         // 4. IMFTransform::ProcessInput(mft, sample)
         // 5. IMFTransform::ProcessOutput(mft) → output sample
-        // 6. Lock output buffer, copy to byte[]
+        // 6. IMFMediaBuffer::Lock → TadFrameBuffer.Rent(cbCurrentLength),
+        //    copy once into PayloadSpan, SetPayloadLength, Unlock
         return null; // Stub — real implementation calls MF COM APIs
     }
 
@@ -823,4 +1009,11 @@ file static class NativeMft
     {
         // ICodecAPI::SetValue(CODECAPI_AVEncVideoForceKeyFrame, true)
     }
+
+    /// <summary>Change the mean bitrate of a running encoder.</summary>
+    public static void SetBitrate(IntPtr mft, int bitrateKbps)
+    {
+        // ICodecAPI::SetValue(CODECAPI_AVEncCommonMeanBitRate, bitrateKbps * 1000)
+        // Supported dynamically by QSV and the MS software encoder in CBR/VBR modes
+    }
 }
@@ -22,6 +22,7 @@ using Microsoft.Extensions.Logging;
 using TADBridge.Driver;
 using TADBridge.Shared;
 using TADBridge.Capture;
+using TADBridge.Session;
 
 namespace TADBridge.Networking;
 
@@ -32,6 +33,7 @@ public sealed class TadTcpListener : BackgroundService
     private readonly ScreenCaptureEngine _capture;
     private readonly PrivacyRedactor _redactor;
     private readonly IHostApplicationLifetime _lifetime;
+    private readonly SnapshotAgentHost _snapshotAgent;
 
     private TcpListener? _listener;
     private NetworkStream? _activeStream;
@@ -63,6 +65,10 @@ public sealed class TadTcpListener : BackgroundService
     private DateTime _prevCpuTime = DateTime.UtcNow;
     private double _lastCpuUsage;
 
+    // Time-to-first-frame for the pending RvStart/RvFocusStart (Stopwatch timestamp, 0 = none)
+    private long _ttffStart;
+    private string _ttffStream = "";
+
     public TadTcpListener(
         ILogger<TadTcpListener> log,
         DriverBridge driver,
@@ -75,6 +81,13 @@ public sealed class TadTcpListener : BackgroundService
         _capture = capture;
         _redactor = redactor;
         _lifetime = lifetime;
+        _snapshotAgent = new SnapshotAgentHost(log, cmd => LaunchInUserSession(cmd));
+    }
+
+    public override void Dispose()
+    {
+        _snapshotAgent.Dispose();
+        base.Dispose();
     }
 
     protected override async Task ExecuteAsync(CancellationToken ct)
@@ -127,6 +140,14 @@ public sealed class TadTcpListener : BackgroundService
                 // shows this student right away, without waiting for the 3-second cycle.
                 SendStatusNow();
 
+                // Bring up DXGI + encoders in the background so the first
+                // RvStart/RvFocusStart does not pay for device creation.
+                _ = Task.Run(WarmCapture, ct);
+
+                // Same for the user-session snapshot agent: the first
+                // room-wide snapshot round should not wait for a process start.
+                _ = _snapshotAgent.WarmAsync(ct);
+
                 await HandleConnectionAsync(client, ct);
             }
             catch (OperationCanceledException) { break; }
@@ -169,6 +190,7 @@ public sealed class TadTcpListener : BackgroundService
 
             // Auto-cleanup on disconnect
             if (_isStreaming) StopStreaming();
+            try { _capture.Cool(); } catch (Exception ex) { _log.LogDebug(ex, "Capture cool-down failed"); }
             if (_isLocked)  ExecuteUnlock();
             if (_isBlanked) ExecuteUnblankScreen();
             if (_isWebLocked) ExecuteWebUnlock();
@@ -220,7 +242,9 @@ public sealed class TadTcpListener : BackgroundService
                 break;
 
             case TadCommand.RvStart:
+                BeginFirstFrameTimer("sub");
                 StartStreaming(ct);
+                PrimeSubViewer();
                 break;
 
             case TadCommand.RvStop:
@@ -228,6 +252,7 @@ public sealed class TadTcpListener : BackgroundService
                 break;
 
             case TadCommand.RvFocusStart:
+                BeginFirstFrameTimer("main");
                 StartMainStream();
                 break;
 
@@ -235,6 +260,19 @@ public sealed class TadTcpListener : BackgroundService
                 StopMainStream();
                 break;
 
+            case TadCommand.RvSetTarget:
+                try
+                {
+                    var target = JsonSerializer.Deserialize<StreamTargetRequest>(payload.Span);
+                    if (target != null)
+                        _capture.SetSubStreamTarget(target.FrameIntervalMs, target.BitrateKbps);
+                }
+                catch (Exception ex)
+                {
+                    _log.LogWarning(ex, "Bad RvSetTarget payload");
+                }
+                break;
+
             case TadCommand.CollectFiles:
                 try
                 {
@@ -678,6 +716,7 @@ public sealed class TadTcpListener : BackgroundService
         {
             var cmd = isKeyFrame ? TadCommand.VideoKeyFrame : TadCommand.VideoFrame;
             SendFrame(cmd, frameData);
+            CompleteFirstFrameTimer("sub", "live encoder");
         };
 
         // Legacy callback for backwards compatibility
@@ -691,6 +730,7 @@ public sealed class TadTcpListener : BackgroundService
         {
             var cmd = isKeyFrame ? TadCommand.MainKeyFrame : TadCommand.MainFrame;
             SendFrame(cmd, frameData);
+            CompleteFirstFrameTimer("main", "live encoder");
         };
 
         try
@@ -713,17 +753,83 @@ public sealed class TadTcpListener : BackgroundService
         if (!_isStreaming) return;
         _isStreaming = false;
 
-        _capture.Stop();
+        // Keep DXGI + encoders warm while the teacher is still connected
+        _capture.StopCapture();
         _log.LogInformation("Screen streaming stopped");
     }
 
     private void StartMainStream()
     {
         if (!_isStreaming) return;
+
+        if (_capture.IsMainStreamActive)
+        {
+            // Viewer re-attached to a running main-stream — replay its GOP
+            int replayed = _capture.MainGop.Replay((frame, key) =>
+                SendFrame(key ? TadCommand.MainKeyFrame : TadCommand.MainFrame, frame));
+            if (replayed > 0) CompleteFirstFrameTimer("main", $"cached main GOP ({replayed} frames)");
+            return;
+        }
+
         _capture.StartMainStream();
+
+        // The RV modal paints sub-stream frames until the first main frame
+        // arrives, so the cached sub GOP gives an immediate picture.
+        PrimeSubViewer();
         _log.LogInformation("Main-stream started (30fps, 720p)");
     }
 
+    private void WarmCapture()
+    {
+        try { _capture.Warm(); }
+        catch (Exception ex)
+        {
+            // Same Session 0 caveat as StartStreaming — streaming will retry on RvStart
+            _log.LogDebug(ex, "Capture warm-up failed");
+        }
+    }
+
+    /// <summary>
+    /// Send the cached sub-stream GOP so a new viewer can decode at once,
+    /// then ask the encoder for a fresh IDR for everything after it.
+    /// </summary>
+    private void PrimeSubViewer()
+    {
+        if (!_isStreaming) return;
+
+        int replayed = _capture.SubGop.Replay((frame, key) =>
+            SendFrame(key ? TadCommand.VideoKeyFrame : TadCommand.VideoFrame, frame));
+        _capture.RequestSubKeyFrame();
+
+        if (replayed > 0)
+            CompleteFirstFrameTimer(null, $"cached sub GOP ({replayed} frames)");
+    }
+
+    // ─── Time-to-First-Frame ──────────────────────────────────────────
+
+    private void BeginFirstFrameTimer(string stream)
+    {
+        _ttffStream = stream;
+        Interlocked.Exchange(ref _ttffStart, System.Diagnostics.Stopwatch.GetTimestamp());
+    }
+
+    /// <summary>
+    /// Log the time from the pending RvStart/RvFocusStart to the first frame
+    /// sent for it. <paramref name="stream"/> = null matches any pending request.
+    /// </summary>
+    private void CompleteFirstFrameTimer(string? stream, string source)
+    {
+        if (Volatile.Read(ref _ttffStart) == 0) return;
+        if (stream != null && stream != _ttffStream) return;
+
+        long start = Interlocked.Exchange(ref _ttffStart, 0);
+        if (start == 0) return;
+
+        var elapsed = System.Diagnostics.Stopwatch.GetElapsedTime(start);
+        _log.LogInformation("Time-to-first-frame ({Stream}): {Ms:F1} ms via {Source}",
+            _ttffStream, elapsed.TotalMilliseconds, source);
+    }
+
     private void StopMainStream()
     {
         _capture.StopMainStream();
@@ -781,40 +887,27 @@ public sealed class TadTcpListener : BackgroundService
     /// <summary>
     /// Capture the primary screen as JPEG and send it back as SnapshotData.
     /// When running as a service in Session 0, GDI+ CopyFromScreen only sees
-    /// the empty Session 0 desktop. Use CreateProcessAsUser to capture from
-    /// the interactive user session instead.
+    /// the empty Session 0 desktop, so the capture is done by the persistent
+    /// snapshot agent in the interactive session (SnapshotAgentHost).
+    ///
+    /// Snapshots bypass the GPU redaction in ScreenCaptureEngine: the agent
+    /// receives the current redaction rects with each request, and the GDI
+    /// fallback redacts in-process, both before JPEG encoding.
     /// </summary>
     private async Task SendSnapshotAsync()
     {
         try
         {
-            // 1. Attempt user-session capture via CreateProcessAsUser
-            var tempFile = Path.Combine(Path.GetTempPath(), $"tad_snap_{Guid.NewGuid():N}.jpg");
-            var cmd = "powershell.exe -WindowStyle Hidden -Command \"" +
-                "Add-Type -AssemblyName System.Windows.Forms,System.Drawing; " +
-                "$b=[System.Windows.Forms.Screen]::PrimaryScreen.Bounds; " +
-                "$bmp=New-Object System.Drawing.Bitmap($b.Width,$b.Height); " +
-                "$g=[System.Drawing.Graphics]::FromImage($bmp); " +
-                "$g.CopyFromScreen($b.Location,[System.Drawing.Point]::Empty,$b.Size); " +
-                "$c=[System.Drawing.Imaging.ImageCodecInfo]::GetImageEncoders()|?{$_.MimeType-eq'image/jpeg'}; " +
-                "$p=New-Object System.Drawing.Imaging.EncoderParameters(1); " +
-                "$p.Param[0]=New-Object System.Drawing.Imaging.EncoderParameter(" +
-                "[System.Drawing.Imaging.Encoder]::Quality,60L); " +
-                "$bmp.Save('" + tempFile.Replace("\\", "\\\\") + "',$c,$p); " +
-                "$g.Dispose(); $bmp.Dispose()\"";
-
-            var proc = LaunchInUserSession(cmd);
-            if (proc != null)
+            // 1. User-session agent (one pipe round trip, no process start)
+            var result = await _snapshotAgent.CaptureAsync(60, _redactor.Style, _redactor.Snapshot.Rects);
+            if (result != null)
             {
-                await Task.Run(() => proc.WaitForExit(5000));
-                if (File.Exists(tempFile))
-                {
-                    var data = await File.ReadAllBytesAsync(tempFile);
-                    SendFrame(TadCommand.SnapshotData, data);
-                    try { File.Delete(tempFile); } catch { }
-                    _log.LogDebug("Snapshot sent via user-session capture ({Bytes} bytes)", data.Length);
-                    return;
-                }
+                SendFrame(TadCommand.SnapshotData, result.Jpeg.Span);
+                _log.LogDebug(
+                    "Snapshot sent via session agent ({Bytes} bytes, capture {Cap:F1} ms, encode {Enc:F1} ms, round trip {Rtt:F1} ms)",
+                    result.Jpeg.Length, result.CaptureMicros / 1000.0, result.EncodeMicros / 1000.0,
+                    _snapshotAgent.LastLatency.TotalMilliseconds);
+                return;
             }
 
             // 2. Fallback: direct GDI capture (works in emulation / interactive mode)
@@ -831,23 +924,11 @@ public sealed class TadTcpListener : BackgroundService
                 using (var g = System.Drawing.Graphics.FromImage(bmp))
                     g.CopyFromScreen(bounds.Location, System.Drawing.Point.Empty, bounds.Size);
 
-                var jpegCodec = System.Drawing.Imaging.ImageCodecInfo
-                    .GetImageEncoders()
-                    .FirstOrDefault(e => e.FormatID == System.Drawing.Imaging.ImageFormat.Jpeg.Guid);
-
-                using var ms = new MemoryStream();
-                if (jpegCodec != null)
-                {
-                    var ep = new System.Drawing.Imaging.EncoderParameters(1);
-                    ep.Param[0] = new System.Drawing.Imaging.EncoderParameter(
-                        System.Drawing.Imaging.Encoder.Quality, 75L);
-                    bmp.Save(ms, jpegCodec, ep);
-                }
-                else
-                {
-                    bmp.Save(ms, System.Drawing.Imaging.ImageFormat.Jpeg);
-                }
+                int redacted = _redactor.Redact(bmp, bounds.Location);
+                if (redacted > 0)
+                    _log.LogDebug("Snapshot: redacted {Count} region(s)", redacted);
 
+                using var ms = EncodeJpeg(bmp, 75);
                 SendFrame(TadCommand.SnapshotData, ms.GetBuffer().AsSpan(0, (int)ms.Length));
                 _log.LogDebug("Snapshot sent via direct capture ({Bytes} bytes)", ms.Length);
             });
@@ -858,6 +939,27 @@ public sealed class TadTcpListener : BackgroundService
         }
     }
 
+    private static MemoryStream EncodeJpeg(System.Drawing.Bitmap bmp, long quality)
+    {
+        var jpegCodec = System.Drawing.Imaging.ImageCodecInfo
+            .GetImageEncoders()
+            .FirstOrDefault(e => e.FormatID == System.Drawing.Imaging.ImageFormat.Jpeg.Guid);
+
+        var ms = new MemoryStream();
+        if (jpegCodec != null)
+        {
+            var ep = new System.Drawing.Imaging.EncoderParameters(1);
+            ep.Param[0] = new System.Drawing.Imaging.EncoderParameter(
+                System.Drawing.Imaging.Encoder.Quality, quality);
+            bmp.Save(ms, jpegCodec, ep);
+        }
+        else
+        {
+            bmp.Save(ms, System.Drawing.Imaging.ImageFormat.Jpeg);
+        }
+        return ms;
+    }
+
     // ─── Status Beacon ────────────────────────────────────────────────
 
     private StudentStatus BuildStatus()
@@ -988,6 +1090,7 @@ public sealed class TadTcpListener : BackgroundService
             IsProgramLocked = _isProgramLocked,
             IsNetworkConnected = !_networkDisconnected,
             ActiveWindow   = GetForegroundWindowTitle(),
+            DirtyRatio     = _isStreaming ? _capture.DirtyRatio : 0,
             CpuUsage       = cpuUsage,
             RamUsedMb      = ramUsedMb,
             RamTotalMb     = ramTotalMb,
@@ -1305,6 +1408,21 @@ public sealed class TadTcpListener : BackgroundService
         }
     }
 
+    /// <summary>
+    /// Send a pooled encoder frame without copying: the header is written
+    /// into the buffer's reserved space and the whole frame goes out in one
+    /// write. The caller keeps ownership of its reference.
+    /// </summary>
+    private void SendFrame(TadCommand cmd, TadFrameBuffer frame)
+    {
+        lock (_streamLock)
+        {
+            if (_activeStream == null) return;
+            try { _activeStream.Write(frame.Seal(cmd)); }
+            catch { /* Connection may be lost */ }
+        }
+    }
+
     private static string GetLocalIp()
     {
         try
@@ -5,6 +5,7 @@
 // Default runtime is user-mode only (no kernel driver dependency).
 // Use --kernel for legacy kernel-driver communication mode.
 // Use --demo to enable synthetic alert generation for showcases.
+// --snapshot-agent is internal: the service starts it in the user session.
 // ───────────────────────────────────────────────────────────────────────────
 
 using Microsoft.Extensions.DependencyInjection;
@@ -18,6 +19,7 @@ using TADBridge.Provisioning;
 using TADBridge.Cache;
 using TADBridge.Capture;
 using TADBridge.Networking;
+using TADBridge.Session;
 using TADBridge.Tray;
 
 // ── Tray-only mode (launched at user logon via HKLM Run key) ───────────────
@@ -35,6 +37,13 @@ if (args.Any(a => a.Equals("--tray", StringComparison.OrdinalIgnoreCase)))
     return;
 }
 
+// ── Snapshot agent (launched by the service in the user session) ───────────
+if (args.Any(a => a.Equals(SnapshotAgentProtocol.AgentArgument, StringComparison.OrdinalIgnoreCase)))
+{
+    Environment.ExitCode = SnapshotAgent.Run(args);
+    return;
+}
+
 bool legacyKernelMode = args.Any(a =>
     a.Equals("--kernel", StringComparison.OrdinalIgnoreCase) ||
     a.Equals("--legacy-kernel", StringComparison.OrdinalIgnoreCase) ||
@@ -0,0 +1,192 @@
+// ───────────────────────────────────────────────────────────────────────────
+// SnapshotAgent.cs — User-session capture agent (--snapshot-agent mode)
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// Runs inside the logged-in user's session, started by SnapshotAgentHost via
+// CreateProcessAsUser. Connects back to the service's pipe, sends Hello and
+// then serves Capture requests until the pipe closes or Shutdown arrives.
+//
+// Capture resources (bitmap, Graphics, JPEG encoder parameters, output
+// buffer) are created once and reused, so a steady-state snapshot is one
+// BitBlt, one redaction pass and one JPEG encode — no process start, no disk.
+// ───────────────────────────────────────────────────────────────────────────
+
+using System.Diagnostics;
+using System.Drawing;
+using System.Drawing.Imaging;
+using System.IO.Pipes;
+using System.Runtime.InteropServices;
+using TADBridge.Capture;
+
+namespace TADBridge.Session;
+
+public static class SnapshotAgent
+{
+    private static readonly TimeSpan ConnectTimeout = TimeSpan.FromSeconds(5);
+
+    /// <summary>Entry point for <c>--snapshot-agent --pipe &lt;name&gt;</c>. Returns the process exit code.</summary>
+    public static int Run(string[] args)
+    {
+        int i = Array.FindIndex(args, a => a.Equals(SnapshotAgentProtocol.PipeArgument, StringComparison.OrdinalIgnoreCase));
+        if (i < 0 || i + 1 >= args.Length) return 2;
+        string pipeName = args[i + 1];
+
+        // Physical pixels: without this, Screen.Bounds and CopyFromScreen are
+        // DPI-virtualised and redaction rects (physical) would not line up.
+        try { SetProcessDpiAwarenessContext(DpiAwarenessPerMonitorV2); } catch { }
+
+        try
+        {
+            using var pipe = new NamedPipeClientStream(".", pipeName, PipeDirection.InOut, PipeOptions.Asynchronous);
+            pipe.Connect((int)ConnectTimeout.TotalMilliseconds);
+            using var capturer = new Capturer();
+            ServeAsync(pipe, capturer).GetAwaiter().GetResult();
+            return 0;
+        }
+        catch
+        {
+            // Nothing to report to — the service restarts the agent on demand
+            return 1;
+        }
+    }
+
+    private static async Task ServeAsync(Stream pipe, Capturer capturer)
+    {
+        var ct = CancellationToken.None;
+        using var self = Process.GetCurrentProcess();
+        var hello = new AgentHello { ProcessId = self.Id, SessionId = self.SessionId };
+        await SnapshotAgentProtocol.WriteAsync(pipe, AgentMessageType.Hello, hello.Encode(), ct);
+
+        while (true)
+        {
+            var msg = await SnapshotAgentProtocol.ReadAsync(pipe, ct);
+            if (msg == null) return;
+
+            switch (msg.Value.Type)
+            {
+                case AgentMessageType.Capture:
+                    var req = AgentCaptureRequest.Decode(msg.Value.Payload);
+                    var result = capturer.Capture(req);
+                    await SnapshotAgentProtocol.WriteAsync(pipe, AgentMessageType.CaptureResult, result.Encode(), ct);
+                    break;
+
+                case AgentMessageType.Ping:
+                    await SnapshotAgentProtocol.WriteAsync(pipe, AgentMessageType.Pong, default, ct);
+                    break;
+
+                case AgentMessageType.Shutdown:
+                    return;
+            }
+        }
+    }
+
+    // ─── Capture ──────────────────────────────────────────────────────
+
+    private sealed class Capturer : IDisposable
+    {
+        private readonly ImageCodecInfo? _jpegCodec = ImageCodecInfo.GetImageEncoders()
+            .FirstOrDefault(e => e.FormatID == ImageFormat.Jpeg.Guid);
+        private readonly MemoryStream _output = new();
+        private Bitmap? _bitmap;
+        private Graphics? _graphics;
+
+        public AgentCaptureResult Capture(AgentCaptureRequest req)
+        {
+            var result = new AgentCaptureResult { RequestId = req.RequestId };
+            try
+            {
+                var screen = System.Windows.Forms.Screen.PrimaryScreen;
+                if (screen == null)
+                {
+                    result.Status = AgentCaptureStatus.NoScreen;
+                    return result;
+                }
+
+                var bounds = screen.Bounds;
+                EnsureBitmap(bounds.Width, bounds.Height);
+
+                long t0 = Stopwatch.GetTimestamp();
+                _graphics!.CopyFromScreen(bounds.Location, Point.Empty, bounds.Size);
+                Redact(_bitmap!, bounds.Location, req);
+                long t1 = Stopwatch.GetTimestamp();
+
+                _output.SetLength(0);
+                if (_jpegCodec != null)
+                {
+                    using var ep = new EncoderParameters(1);
+                    ep.Param[0] = new EncoderParameter(Encoder.Quality, (long)req.Quality);
+                    _bitmap!.Save(_output, _jpegCodec, ep);
+                }
+                else
+                {
+                    _bitmap!.Save(_output, ImageFormat.Jpeg);
+                }
+                long t2 = Stopwatch.GetTimestamp();
+
+                result.Status = AgentCaptureStatus.Ok;
+                result.Width = (ushort)bounds.Width;
+                result.Height = (ushort)bounds.Height;
+                result.CaptureMicros = (uint)Stopwatch.GetElapsedTime(t0, t1).TotalMicroseconds;
+                result.EncodeMicros = (uint)Stopwatch.GetElapsedTime(t1, t2).TotalMicroseconds;
+                result.Jpeg = _output.GetBuffer().AsMemory(0, (int)_output.Length);
+            }
+            catch
+            {
+                // Display mode change / secure desktop: rebuild next time
+                DisposeBitmap();
+                result.Status = AgentCaptureStatus.Failed;
+            }
+            return result;
+        }
+
+        private static unsafe void Redact(Bitmap bmp, Point origin, AgentCaptureRequest req)
+        {
+            if (req.Rects.Count == 0) return;
+
+            var data = bmp.LockBits(
+                new Rectangle(0, 0, bmp.Width, bmp.Height),
+                ImageLockMode.ReadWrite, PixelFormat.Format32bppArgb);
+            try
+            {
+                var span = new Span<byte>((void*)data.Scan0, data.Stride * data.Height);
+                RedactionKernel.Apply(span, data.Width, data.Height, data.Stride, req.Rects, req.Style,
+                    originX: origin.X, originY: origin.Y);
+            }
+            finally
+            {
+                bmp.UnlockBits(data);
+            }
+        }
+
+        private void EnsureBitmap(int width, int height)
+        {
+            if (_bitmap != null && _bitmap.Width == width && _bitmap.Height == height) return;
+
+            DisposeBitmap();
+            _bitmap = new Bitmap(width, height, PixelFormat.Format32bppArgb);
+            _graphics = Graphics.FromImage(_bitmap);
+        }
+
+        private void DisposeBitmap()
+        {
+            _graphics?.Dispose();
+            _bitmap?.Dispose();
+            _graphics = null;
+            _bitmap = null;
+        }
+
+        public void Dispose()
+        {
+            DisposeBitmap();
+            _output.Dispose();
+        }
+    }
+
+    // ─── P/Invoke ─────────────────────────────────────────────────────
+
+    private static readonly IntPtr DpiAwarenessPerMonitorV2 = new(-4);
+
+    [DllImport("user32.dll")]
+    private static extern bool SetProcessDpiAwarenessContext(IntPtr value);
+}
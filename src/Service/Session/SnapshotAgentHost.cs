@@ -0,0 +1,298 @@
+// ───────────────────────────────────────────────────────────────────────────
+// SnapshotAgentHost.cs — Service-side owner of the user-session snapshot agent
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// Snapshots used to start a new powershell.exe in the user session for
+// every request: load WinForms + System.Drawing, CopyFromScreen, write a
+// temp JPEG, and let the service poll for the file. That cost 1–3 s of
+// PowerShell startup per student per snapshot round.
+//
+// The host now launches one agent per interactive session and keeps it:
+//   1. Create a named pipe with a random name (SYSTEM + interactive users).
+//   2. CreateProcessAsUser: TADBridgeService.exe --snapshot-agent --pipe <name>
+//   3. Accept the connection only from the launched PID; expect Hello.
+//   4. Each snapshot is one Capture → CaptureResult round trip.
+//
+// The agent is restarted if it exits, the pipe breaks, or the console
+// session changes (fast user switching / logoff). Launch failures back off
+// for 30 s so a machine with nobody logged in does not spawn in a loop;
+// callers fall back to direct GDI capture in the meantime.
+//
+// JPEGs travel inline over the pipe. At snapshot sizes (100–400 KB) a local
+// pipe write is well under a millisecond, so a shared-memory section would
+// add cross-session ACL and lifetime handling without a measurable gain.
+// ───────────────────────────────────────────────────────────────────────────
+
+using System.Diagnostics;
+using System.IO.Pipes;
+using System.Runtime.InteropServices;
+using System.Security.AccessControl;
+using System.Security.Principal;
+using Microsoft.Extensions.Logging;
+using TADBridge.Capture;
+using TADBridge.Shared;
+
+namespace TADBridge.Session;
+
+public sealed class SnapshotAgentHost : IDisposable
+{
+    private readonly ILogger _log;
+    private readonly Func<string, Process?> _launch;
+    private readonly SemaphoreSlim _gate = new(1, 1);
+
+    private NamedPipeServerStream? _pipe;
+    private Process? _agent;
+    private int _agentSessionId = -1;
+    private uint _nextRequestId;
+    private long _retryAfterMs;
+    private bool _disposed;
+
+    private static readonly TimeSpan ConnectTimeout = TimeSpan.FromSeconds(10);
+    private static readonly TimeSpan CaptureTimeout = TimeSpan.FromSeconds(3);
+    private const int LaunchBackoffMs = 30_000;
+
+    /// <summary>Successful agent round trips since service start.</summary>
+    public long Captures { get; private set; }
+
+    /// <summary>Agent launches since service start (1 = never restarted).</summary>
+    public int Launches { get; private set; }
+
+    /// <summary>Round-trip time of the last successful capture.</summary>
+    public TimeSpan LastLatency { get; private set; }
+
+    public bool IsConnected => _pipe is { IsConnected: true } && _agent is { HasExited: false };
+
+    /// <param name="launch">
+    /// Starts a command line in the interactive session (CreateProcessAsUser)
+    /// and returns the process, or null if no user session is available.
+    /// </param>
+    public SnapshotAgentHost(ILogger log, Func<string, Process?> launch)
+    {
+        _log = log;
+        _launch = launch;
+    }
+
+    // ─── Public API ───────────────────────────────────────────────────
+
+    /// <summary>
+    /// Start the agent ahead of the first snapshot (e.g. when a teacher connects).
+    /// </summary>
+    public async Task WarmAsync(CancellationToken ct = default)
+    {
+        await _gate.WaitAsync(ct);
+        try
+        {
+            await EnsureAgentAsync(ct);
+        }
+        catch (Exception ex) when (ex is not OperationCanceledException)
+        {
+            _log.LogDebug(ex, "Snapshot agent warm-up failed");
+        }
+        finally
+        {
+            _gate.Release();
+        }
+    }
+
+    /// <summary>
+    /// Capture the primary screen in the user session as JPEG.
+    /// Returns null if no agent is available (caller falls back to GDI).
+    /// </summary>
+    public async Task<AgentCaptureResult?> CaptureAsync(
+        int quality, RedactionStyle style, IReadOnlyList<RedactionRect> rects, CancellationToken ct = default)
+    {
+        await _gate.WaitAsync(ct);
+        try
+        {
+            if (!await EnsureAgentAsync(ct)) return null;
+
+            var sw = Stopwatch.StartNew();
+            var req = new AgentCaptureRequest
+            {
+                RequestId = ++_nextRequestId,
+                Quality = (byte)Math.Clamp(quality, 1, 100),
+                Style = style,
+                Rects = rects,
+            };
+
+            using var timeout = CancellationTokenSource.CreateLinkedTokenSource(ct);
+            timeout.CancelAfter(CaptureTimeout);
+
+            await SnapshotAgentProtocol.WriteAsync(_pipe!, AgentMessageType.Capture, req.Encode(), timeout.Token);
+
+            // Skip anything stale (e.g. a Pong); a reply to an older request
+            // that timed out is discarded here as well.
+            while (true)
+            {
+                var msg = await SnapshotAgentProtocol.ReadAsync(_pipe!, timeout.Token)
+                    ?? throw new EndOfStreamException("Snapshot agent closed the pipe");
+                if (msg.Type != AgentMessageType.CaptureResult) continue;
+
+                var result = AgentCaptureResult.Decode(msg.Payload);
+                if (result.RequestId != req.RequestId) continue;
+
+                LastLatency = sw.Elapsed;
+                if (result.Status != AgentCaptureStatus.Ok)
+                {
+                    _log.LogDebug("Snapshot agent returned {Status}", result.Status);
+                    return null;
+                }
+
+                Captures++;
+                return result;
+            }
+        }
+        catch (Exception ex) when (ex is not OperationCanceledException || !ct.IsCancellationRequested)
+        {
+            _log.LogWarning("Snapshot agent round trip failed ({Error}) — restarting agent", ex.Message);
+            StopAgent();
+            return null;
+        }
+        finally
+        {
+            _gate.Release();
+        }
+    }
+
+    // ─── Agent Lifecycle ──────────────────────────────────────────────
+
+    private async Task<bool> EnsureAgentAsync(CancellationToken ct)
+    {
+        if (_disposed) return false;
+
+        int session = WTSGetActiveConsoleSessionId();
+        if (IsConnected && session == _agentSessionId) return true;
+
+        if (_agent != null)
+        {
+            _log.LogInformation("Snapshot agent lost (session {Old} → {New}, exited={Exited}) — restarting",
+                _agentSessionId, session, _agent.HasExited);
+            StopAgent();
+        }
+
+        if (Environment.TickCount64 < _retryAfterMs) return false;
+
+        var exe = Environment.ProcessPath;
+        if (exe == null) return false;
+
+        var pipeName = SnapshotAgentProtocol.NewPipeName();
+        var pipe = CreatePipe(pipeName);
+        var cmd = $"\"{exe}\" {SnapshotAgentProtocol.AgentArgument} {SnapshotAgentProtocol.PipeArgument} {pipeName}";
+
+        var proc = _launch(cmd);
+        if (proc == null)
+        {
+            pipe.Dispose();
+            _retryAfterMs = Environment.TickCount64 + LaunchBackoffMs;
+            return false;
+        }
+        Launches++;
+
+        try
+        {
+            using var timeout = CancellationTokenSource.CreateLinkedTokenSource(ct);
+            timeout.CancelAfter(ConnectTimeout);
+            await pipe.WaitForConnectionAsync(timeout.Token);
+
+            // Only the process we launched may use this pipe
+            if (!GetNamedPipeClientProcessId(pipe.SafePipeHandle.DangerousGetHandle(), out uint clientPid)
+                || clientPid != (uint)proc.Id)
+                throw new InvalidOperationException($"Unexpected pipe client PID {clientPid} (expected {proc.Id})");
+
+            var msg = await SnapshotAgentProtocol.ReadAsync(pipe, timeout.Token);
+            if (msg is not { Type: AgentMessageType.Hello })
+                throw new InvalidDataException("Snapshot agent did not send Hello");
+
+            var hello = AgentHello.Decode(msg.Value.Payload);
+            if (hello.Version != SnapshotAgentProtocol.Version)
+                throw new InvalidDataException($"Snapshot agent protocol v{hello.Version}, expected v{SnapshotAgentProtocol.Version}");
+
+            _pipe = pipe;
+            _agent = proc;
+            _agentSessionId = hello.SessionId;
+            _log.LogInformation("Snapshot agent ready (PID {Pid}, session {Sid})", hello.ProcessId, hello.SessionId);
+            return true;
+        }
+        catch (Exception ex) when (ex is not OperationCanceledException || !ct.IsCancellationRequested)
+        {
+            _log.LogWarning("Snapshot agent failed to start: {Error}", ex.Message);
+            pipe.Dispose();
+            TryKill(proc);
+            _retryAfterMs = Environment.TickCount64 + LaunchBackoffMs;
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Pipe readable/writable by the interactive user; the service keeps
+    /// full control. Names are random per launch, so other sessions cannot
+    /// guess them, and the client PID is checked on connect.
+    /// </summary>
+    private static NamedPipeServerStream CreatePipe(string name)
+    {
+        var security = new PipeSecurity();
+        security.AddAccessRule(new PipeAccessRule(
+            new SecurityIdentifier(WellKnownSidType.LocalSystemSid, null),
+            PipeAccessRights.FullControl, AccessControlType.Allow));
+        security.AddAccessRule(new PipeAccessRule(
+            new SecurityIdentifier(WellKnownSidType.InteractiveSid, null),
+            PipeAccessRights.ReadWrite, AccessControlType.Allow));
+
+        return NamedPipeServerStreamAcl.Create(
+            name, PipeDirection.InOut, 1, PipeTransmissionMode.Byte,
+            PipeOptions.Asynchronous, 0, 0, security);
+    }
+
+    private void StopAgent()
+    {
+        var pipe = _pipe;
+        var agent = _agent;
+        _pipe = null;
+        _agent = null;
+        _agentSessionId = -1;
+
+        if (pipe != null)
+        {
+            try
+            {
+                if (pipe.IsConnected)
+                    SnapshotAgentProtocol.WriteAsync(pipe, AgentMessageType.Shutdown, default, CancellationToken.None)
+                        .Wait(500);
+            }
+            catch { }
+            pipe.Dispose();
+        }
+
+        if (agent != null && !agent.WaitForExit(1000))
+            TryKill(agent);
+        agent?.Dispose();
+    }
+
+    private static void TryKill(Process proc)
+    {
+        try { if (!proc.HasExited) proc.Kill(); } catch { }
+    }
+
+    public void Dispose()
+    {
+        _gate.Wait();
+        try
+        {
+            _disposed = true;
+            StopAgent();
+        }
+        finally
+        {
+            _gate.Release();
+        }
+    }
+
+    // ─── P/Invoke ─────────────────────────────────────────────────────
+
+    [DllImport("kernel32.dll")]
+    private static extern int WTSGetActiveConsoleSessionId();
+
+    [DllImport("kernel32.dll", SetLastError = true)]
+    private static extern bool GetNamedPipeClientProcessId(IntPtr pipe, out uint clientProcessId);
+}
@@ -0,0 +1,269 @@
+// ───────────────────────────────────────────────────────────────────────────
+// SnapshotAgentProtocol.cs — Service ↔ user-session snapshot agent IPC
+//
+// (C) 2026 TAD Europe — https://tad-it.eu
+//
+// The service runs in Session 0 and cannot see the interactive desktop.
+// Snapshots are taken by a long-lived agent (TADBridgeService.exe
+// --snapshot-agent) started once in the user's session; the two talk over
+// a named pipe the service creates with a random name per agent launch.
+//
+// This file is transport-agnostic: it only needs a duplex Stream, so the
+// same framing works over a NamedPipe on Windows and a Unix-domain socket
+// (NetworkStream) elsewhere.
+//
+// Wire format (big-endian, same layout as TadFrameCodec):
+//   [4 bytes] length of (type + payload)
+//   [1 byte]  AgentMessageType
+//   [N bytes] payload
+//
+//   Hello          agent → service   version, process id, session id
+//   Capture        service → agent   request id, JPEG quality, redaction style + rects
+//   CaptureResult  agent → service   request id, status, size, timings, JPEG
+//   Ping / Pong    liveness check
+//   Shutdown       service → agent   exit cleanly
+// ───────────────────────────────────────────────────────────────────────────
+
+using System.Buffers;
+using System.Buffers.Binary;
+using TADBridge.Capture;
+using TADBridge.Shared;
+
+namespace TADBridge.Session;
+
+public enum AgentMessageType : byte
+{
+    Hello         = 0x01,
+    Capture       = 0x10,
+    CaptureResult = 0x11,
+    Ping          = 0x20,
+    Pong          = 0x21,
+    Shutdown      = 0x7F,
+}
+
+public enum AgentCaptureStatus : byte
+{
+    Ok       = 0,
+    NoScreen = 1,
+    Failed   = 2,
+}
+
+/// <summary>One received message. Payload is owned by the caller.</summary>
+public readonly struct AgentMessage
+{
+    public AgentMessageType Type { get; }
+    public byte[] Payload { get; }
+
+    public AgentMessage(AgentMessageType type, byte[] payload)
+    {
+        Type = type;
+        Payload = payload;
+    }
+}
+
+public static class SnapshotAgentProtocol
+{
+    public const ushort Version = 1;
+    public const int HeaderSize = 5;
+
+    /// <summary>Upper bound on a single message (a 4K JPEG at q=100 is ~6 MB).</summary>
+    public const int MaxMessageBytes = 32 * 1024 * 1024;
+
+    public const string AgentArgument = "--snapshot-agent";
+    public const string PipeArgument = "--pipe";
+
+    /// <summary>Fresh, unguessable pipe name for one agent launch.</summary>
+    public static string NewPipeName() => $"TADBridge.SnapshotAgent.{Guid.NewGuid():N}";
+
+    // ─── Framing ──────────────────────────────────────────────────────
+
+    /// <summary>Write one message as a single Stream write (header + payload).</summary>
+    public static async Task WriteAsync(
+        Stream stream, AgentMessageType type, ReadOnlyMemory<byte> payload, CancellationToken ct)
+    {
+        int total = HeaderSize + payload.Length;
+        var buf = ArrayPool<byte>.Shared.Rent(total);
+        try
+        {
+            BinaryPrimitives.WriteInt32BigEndian(buf, 1 + payload.Length);
+            buf[4] = (byte)type;
+            payload.Span.CopyTo(buf.AsSpan(HeaderSize));
+            await stream.WriteAsync(buf.AsMemory(0, total), ct);
+            await stream.FlushAsync(ct);
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(buf);
+        }
+    }
+
+    /// <summary>
+    /// Read one message. Returns null on a clean end-of-stream before the
+    /// header; throws <see cref="InvalidDataException"/> on a malformed frame.
+    /// </summary>
+    public static async Task<AgentMessage?> ReadAsync(Stream stream, CancellationToken ct)
+    {
+        var header = new byte[HeaderSize];
+        int read = 0;
+        while (read < HeaderSize)
+        {
+            int n = await stream.ReadAsync(header.AsMemory(read), ct);
+            if (n == 0)
+            {
+                if (read == 0) return null;
+                throw new EndOfStreamException("Agent stream closed mid-header");
+            }
+            read += n;
+        }
+
+        int length = BinaryPrimitives.ReadInt32BigEndian(header);
+        if (length < 1 || length > MaxMessageBytes)
+            throw new InvalidDataException($"Agent message length {length} out of range");
+
+        var payload = new byte[length - 1];
+        await stream.ReadExactlyAsync(payload, ct);
+        return new AgentMessage((AgentMessageType)header[4], payload);
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Messages
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// <summary>First message from the agent after connecting.</summary>
+public sealed class AgentHello
+{
+    public ushort Version { get; set; } = SnapshotAgentProtocol.Version;
+    public int ProcessId { get; set; }
+    public int SessionId { get; set; }
+
+    public byte[] Encode()
+    {
+        var buf = new byte[10];
+        BinaryPrimitives.WriteUInt16BigEndian(buf, Version);
+        BinaryPrimitives.WriteInt32BigEndian(buf.AsSpan(2), ProcessId);
+        BinaryPrimitives.WriteInt32BigEndian(buf.AsSpan(6), SessionId);
+        return buf;
+    }
+
+    public static AgentHello Decode(ReadOnlySpan<byte> p)
+    {
+        if (p.Length < 10) throw new InvalidDataException("Short Hello");
+        return new AgentHello
+        {
+            Version = BinaryPrimitives.ReadUInt16BigEndian(p),
+            ProcessId = BinaryPrimitives.ReadInt32BigEndian(p[2..]),
+            SessionId = BinaryPrimitives.ReadInt32BigEndian(p[6..]),
+        };
+    }
+}
+
+/// <summary>
+/// Capture request. Redaction rects are taken from the service's
+/// PrivacyRedactor at request time and applied by the agent before encoding,
+/// so unredacted pixels never leave the user session.
+/// </summary>
+public sealed class AgentCaptureRequest
+{
+    public uint RequestId { get; set; }
+    public byte Quality { get; set; } = 75;
+    public RedactionStyle Style { get; set; } = RedactionStyle.Fill;
+    public IReadOnlyList<RedactionRect> Rects { get; set; } = Array.Empty<RedactionRect>();
+
+    public byte[] Encode()
+    {
+        int count = Math.Min(Rects.Count, ushort.MaxValue);
+        var buf = new byte[8 + count * 16];
+        var s = buf.AsSpan();
+        BinaryPrimitives.WriteUInt32BigEndian(s, RequestId);
+        s[4] = Quality;
+        s[5] = (byte)Style;
+        BinaryPrimitives.WriteUInt16BigEndian(s[6..], (ushort)count);
+        for (int i = 0; i < count; i++)
+        {
+            var r = Rects[i];
+            var o = s[(8 + i * 16)..];
+            BinaryPrimitives.WriteInt32BigEndian(o, r.X);
+            BinaryPrimitives.WriteInt32BigEndian(o[4..], r.Y);
+            BinaryPrimitives.WriteInt32BigEndian(o[8..], r.Width);
+            BinaryPrimitives.WriteInt32BigEndian(o[12..], r.Height);
+        }
+        return buf;
+    }
+
+    public static AgentCaptureRequest Decode(ReadOnlySpan<byte> p)
+    {
+        if (p.Length < 8) throw new InvalidDataException("Short Capture request");
+        int count = BinaryPrimitives.ReadUInt16BigEndian(p[6..]);
+        if (p.Length < 8 + count * 16) throw new InvalidDataException("Truncated redaction rects");
+
+        var rects = new RedactionRect[count];
+        for (int i = 0; i < count; i++)
+        {
+            var o = p[(8 + i * 16)..];
+            rects[i] = new RedactionRect
+            {
+                X = BinaryPrimitives.ReadInt32BigEndian(o),
+                Y = BinaryPrimitives.ReadInt32BigEndian(o[4..]),
+                Width = BinaryPrimitives.ReadInt32BigEndian(o[8..]),
+                Height = BinaryPrimitives.ReadInt32BigEndian(o[12..]),
+            };
+        }
+
+        return new AgentCaptureRequest
+        {
+            RequestId = BinaryPrimitives.ReadUInt32BigEndian(p),
+            Quality = p[4],
+            Style = (RedactionStyle)p[5],
+            Rects = rects,
+        };
+    }
+}
+
+/// <summary>Capture result: encoded JPEG plus timings for diagnostics.</summary>
+public sealed class AgentCaptureResult
+{
+    public const int FixedSize = 17;
+
+    public uint RequestId { get; set; }
+    public AgentCaptureStatus Status { get; set; }
+    public ushort Width { get; set; }
+    public ushort Height { get; set; }
+    public uint CaptureMicros { get; set; }
+    public uint EncodeMicros { get; set; }
+
+    /// <summary>JPEG bytes (empty unless <see cref="Status"/> is Ok).</summary>
+    public ReadOnlyMemory<byte> Jpeg { get; set; }
+
+    /// <summary>Write the fixed fields followed by the JPEG into one buffer.</summary>
+    public byte[] Encode()
+    {
+        var buf = new byte[FixedSize + Jpeg.Length];
+        var s = buf.AsSpan();
+        BinaryPrimitives.WriteUInt32BigEndian(s, RequestId);
+        s[4] = (byte)Status;
+        BinaryPrimitives.WriteUInt16BigEndian(s[5..], Width);
+        BinaryPrimitives.WriteUInt16BigEndian(s[7..], Height);
+        BinaryPrimitives.WriteUInt32BigEndian(s[9..], CaptureMicros);
+        BinaryPrimitives.WriteUInt32BigEndian(s[13..], EncodeMicros);
+        Jpeg.Span.CopyTo(s[FixedSize..]);
+        return buf;
+    }
+
+    /// <summary>Decode without copying: <see cref="Jpeg"/> slices <paramref name="payload"/>.</summary>
+    public static AgentCaptureResult Decode(byte[] payload)
+    {
+        var p = payload.AsSpan();
+        if (p.Length < FixedSize) throw new InvalidDataException("Short CaptureResult");
+        return new AgentCaptureResult
+        {
+            RequestId = BinaryPrimitives.ReadUInt32BigEndian(p),
+            Status = (AgentCaptureStatus)p[4],
+            Width = BinaryPrimitives.ReadUInt16BigEndian(p[5..]),
+            Height = BinaryPrimitives.ReadUInt16BigEndian(p[7..]),
+            CaptureMicros = BinaryPrimitives.ReadUInt32BigEndian(p[9..]),
+            EncodeMicros = BinaryPrimitives.ReadUInt32BigEndian(p[13..]),
+            Jpeg = payload.AsMemory(FixedSize),
+        };
+    }
+}
@@ -7,7 +7,9 @@
 // Binary framing: [4-byte length][1-byte command][payload]
 // ───────────────────────────────────────────────────────────────────────────
 
+using System.Buffers;
 using System.Buffers.Binary;
+using System.Collections.Concurrent;
 using System.Text;
 using System.Text.Json;
 
@@ -31,6 +33,7 @@ public enum TadCommand : byte
     RvStop          = 0x21,     // Stop remote view streaming
     RvFocusStart    = 0x22,     // Start main-stream (30fps 720p) for focused view
     RvFocusStop     = 0x23,     // Stop main-stream (keep sub-stream running)
+    RvSetTarget     = 0x24,     // Adjust sub-stream fps/bitrate (teacher bandwidth allocator)
     CollectFiles    = 0x30,     // Request file collection from student
     PushMessage     = 0x40,     // Display a message on student screen
     ChatMessage     = 0x41,     // Teacher → Student chat message
@@ -83,6 +86,8 @@ public sealed class StudentStatus
     public bool IsProgramLocked { get; set; }
     public bool IsNetworkConnected { get; set; } = true;
     public string ActiveWindow { get; set; } = "";
+    /// <summary>Fraction of the screen that changed recently (0.0–1.0), smoothed over the sub-stream.</summary>
+    public double DirtyRatio { get; set; }
     public double CpuUsage { get; set; }
     public long RamUsedMb { get; set; }
     public long RamTotalMb { get; set; }
@@ -106,6 +111,18 @@ public sealed class KillProcessRequest
     public int ProcessId { get; set; }
 }
 
+/// <summary>
+/// Sub-stream encode target assigned by the teacher's bandwidth allocator.
+/// Sent with <see cref="TadCommand.RvSetTarget"/>; the student clamps both
+/// values to its own profile limits.
+/// </summary>
+public sealed class StreamTargetRequest
+{
+    /// <summary>Milliseconds between sub-stream frames (1000 = 1 fps).</summary>
+    public int FrameIntervalMs { get; set; } = 1000;
+    public int BitrateKbps { get; set; } = 200;
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // Blocklist — blocked programs & websites sent from teacher to students
 // ═══════════════════════════════════════════════════════════════════════════
@@ -158,15 +175,23 @@ public static class TadFrameCodec
     /// </summary>
     public static byte[] Encode(TadCommand cmd, ReadOnlySpan<byte> payload = default)
     {
-        int totalPayload = 1 + payload.Length; // cmd byte + data
-        var frame = new byte[4 + totalPayload];
-        BinaryPrimitives.WriteInt32BigEndian(frame.AsSpan(0, 4), totalPayload);
-        frame[4] = (byte)cmd;
+        var frame = new byte[HeaderSize + payload.Length];
+        WriteHeader(frame, cmd, payload.Length);
         if (payload.Length > 0)
-            payload.CopyTo(frame.AsSpan(5));
+            payload.CopyTo(frame.AsSpan(HeaderSize));
         return frame;
     }
 
+    /// <summary>
+    /// Write the 5-byte frame header for a payload of <paramref name="payloadLength"/>
+    /// bytes into the start of <paramref name="destination"/>.
+    /// </summary>
+    public static void WriteHeader(Span<byte> destination, TadCommand cmd, int payloadLength)
+    {
+        BinaryPrimitives.WriteInt32BigEndian(destination, 1 + payloadLength); // cmd byte + data
+        destination[4] = (byte)cmd;
+    }
+
     /// <summary>
     /// Encode a command with a JSON-serialized object payload.
     /// </summary>
@@ -215,6 +240,111 @@ public static class TadFrameCodec
     }
 }
 
+// ═══════════════════════════════════════════════════════════════════════════
+// Pooled Frame Buffer — zero-copy path from encoder to socket
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// <summary>
+/// Reference-counted, ArrayPool-backed wire frame with the 5-byte header
+/// reserved up front. The producer writes the payload directly into
+/// <see cref="PayloadSpan"/>; <see cref="Seal"/> fills in the header and
+/// returns the complete frame for a single socket write, with no copy.
+///
+/// Ownership: <see cref="Rent"/> returns one reference. Anyone who keeps the
+/// buffer beyond the call it was handed to must <see cref="AddRef"/>, and
+/// every reference ends with <see cref="Release"/>. The last release returns
+/// the array (and this wrapper) to their pools.
+/// </summary>
+public sealed class TadFrameBuffer
+{
+    private const int MaxPooledWrappers = 256;
+    private static readonly ConcurrentQueue<TadFrameBuffer> s_wrappers = new();
+
+    private byte[] _array = Array.Empty<byte>();
+    private int _refCount;
+
+    /// <summary>Bytes of payload written so far (excludes the header).</summary>
+    public int PayloadLength { get; private set; }
+
+    /// <summary>Writable payload capacity.</summary>
+    public int PayloadCapacity => _array.Length - TadFrameCodec.HeaderSize;
+
+    /// <summary>Writable payload area (after the reserved header).</summary>
+    public Span<byte> PayloadSpan => _array.AsSpan(TadFrameCodec.HeaderSize);
+
+    /// <summary>Payload written so far.</summary>
+    public ReadOnlySpan<byte> Payload => _array.AsSpan(TadFrameCodec.HeaderSize, PayloadLength);
+
+    private TadFrameBuffer() { }
+
+    /// <summary>Rent a buffer able to hold at least <paramref name="payloadCapacity"/> payload bytes.</summary>
+    public static TadFrameBuffer Rent(int payloadCapacity)
+    {
+        if (payloadCapacity < 0 || payloadCapacity > TadFrameCodec.MaxPayload)
+            throw new ArgumentOutOfRangeException(nameof(payloadCapacity));
+
+        if (!s_wrappers.TryDequeue(out var buf))
+            buf = new TadFrameBuffer();
+
+        buf._array = ArrayPool<byte>.Shared.Rent(TadFrameCodec.HeaderSize + payloadCapacity);
+        buf.PayloadLength = 0;
+        buf._refCount = 1;
+        return buf;
+    }
+
+    /// <summary>Rent a buffer and copy <paramref name="payload"/> into it.</summary>
+    public static TadFrameBuffer CopyFrom(ReadOnlySpan<byte> payload)
+    {
+        var buf = Rent(payload.Length);
+        payload.CopyTo(buf.PayloadSpan);
+        buf.PayloadLength = payload.Length;
+        return buf;
+    }
+
+    /// <summary>Record how many payload bytes the producer wrote into <see cref="PayloadSpan"/>.</summary>
+    public void SetPayloadLength(int length)
+    {
+        if ((uint)length > (uint)PayloadCapacity)
+            throw new ArgumentOutOfRangeException(nameof(length));
+        PayloadLength = length;
+    }
+
+    /// <summary>
+    /// Write the header for <paramref name="cmd"/> and return the complete
+    /// wire frame. Safe to call again (e.g. when a cached frame is replayed).
+    /// </summary>
+    public ReadOnlySpan<byte> Seal(TadCommand cmd)
+    {
+        TadFrameCodec.WriteHeader(_array, cmd, PayloadLength);
+        return _array.AsSpan(0, TadFrameCodec.HeaderSize + PayloadLength);
+    }
+
+    /// <summary>Take an additional reference (e.g. when caching the frame).</summary>
+    public TadFrameBuffer AddRef()
+    {
+        if (Interlocked.Increment(ref _refCount) <= 1)
+            throw new ObjectDisposedException(nameof(TadFrameBuffer));
+        return this;
+    }
+
+    /// <summary>Drop one reference; the last one returns the memory to the pool.</summary>
+    public void Release()
+    {
+        int remaining = Interlocked.Decrement(ref _refCount);
+        if (remaining > 0) return;
+        if (remaining < 0)
+            throw new InvalidOperationException("TadFrameBuffer released more times than referenced");
+
+        var array = _array;
+        _array = Array.Empty<byte>();
+        PayloadLength = 0;
+        ArrayPool<byte>.Shared.Return(array);
+
+        if (s_wrappers.Count < MaxPooledWrappers)
+            s_wrappers.Enqueue(this);
+    }
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // Privacy Redaction Rectangle
 // ═══════════════════════════════════════════════════════════════════════════